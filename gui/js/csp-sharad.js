@@ -11,18 +11,185 @@
     name = 'sharad';
 
     /**
-     * @param file {string}
-     * @param time {string|number}
+     * All known profiles as objects of the form {name, time, state}.
+     *
+     * @type {Object[]}
      */
-    add(file, time) {
-      const sharadList = document.getElementById('list-sharad');
-      const sharad     = CosmoScout.gui.loadTemplateContent('sharad');
+    _profiles = [];
 
-      sharad.innerHTML = sharad.innerHTML.replace(/%FILE%/g, file).replace(/%TIME%/g, time).trim();
+    /**
+     * The profiles which pass the current filter in the current sort order.
+     *
+     * @type {Object[]}
+     */
+    _visibleProfiles = [];
+
+    /**
+     * Height of a single list entry in pixels. This is measured once the list is visible.
+     *
+     * @type {number}
+     */
+    _rowHeight = 0;
+
+    /**
+     * Additional entries which are rendered above and below the visible part of the list.
+     *
+     * @type {number}
+     */
+    _overscan = 5;
+
+    _filter = '';
+    _sortMode = 'time';
+
+    /**
+     * @inheritDoc
+     */
+    init() {
+      this._list      = document.getElementById('list-sharad');
+      this._scrollBox = this._list.parentElement;
+
+      this._scrollBox.addEventListener('scroll', () => this._render());
+
+      // The profiles are usually added while the sidebar tab is still collapsed. Hence the list is
+      // rendered again once it actually gets a size.
+      new ResizeObserver(() => this._render()).observe(this._scrollBox);
+
+      document.getElementById('sharad-filter').addEventListener('input', (event) => {
+        this._filter = event.target.value.toLowerCase();
+        this._update();
+      });
+
+      document.getElementById('sharad-sort').addEventListener('change', (event) => {
+        this._sortMode = event.target.value;
+        this._update();
+      });
+    }
+
+    /**
+     * Removes all profiles from the list.
+     */
+    clear() {
+      this._profiles = [];
+      this._update();
+    }
+
+    /**
+     * Adds a batch of profiles to the list.
+     *
+     * @param profiles {string} JSON array of objects of the form {name, time}
+     */
+    add(profiles) {
+      JSON.parse(profiles).forEach((profile) => {
+        profile.state = 'loaded';
+        this._profiles.push(profile);
+      });
+
+      this._update();
+    }
+
+    /**
+     * Updates the state of several profiles at once.
+     *
+     * @param states {string} JSON object mapping profile names to their new state
+     */
+    setStates(states) {
+      const changes = JSON.parse(states);
+
+      this._profiles.forEach((profile) => {
+        if (profile.name in changes) {
+          profile.state = changes[profile.name];
+        }
+      });
+
+      this._render();
+    }
+
+    /**
+     * Applies filtering and sorting and redraws the list.
+     *
+     * @private
+     */
+    _update() {
+      this._visibleProfiles =
+          this._profiles.filter((profile) => profile.name.toLowerCase().includes(this._filter));
+
+      if (this._sortMode === 'name') {
+        this._visibleProfiles.sort((a, b) => a.name.localeCompare(b.name));
+      } else {
+        this._visibleProfiles.sort((a, b) => a.time - b.time);
+      }
+
+      this._render();
+    }
+
+    /**
+     * Creates DOM nodes only for the entries which are currently scrolled into view. The list
+     * itself is sized to hold all entries so that the scrollbar behaves as usual.
+     *
+     * @private
+     */
+    _render() {
+      if (this._rowHeight === 0 && this._visibleProfiles.length > 0) {
+        this._list.style.height = '';
+        this._list.replaceChildren(this._createEntry(this._visibleProfiles[0], 0));
+        this._rowHeight = this._list.firstElementChild.offsetHeight;
+      }
+
+      // The list is not visible, so there is nothing to render.
+      if (this._rowHeight === 0) {
+        this._list.style.height = '';
+        this._list.replaceChildren();
+        return;
+      }
+
+      const rowHeight = this._rowHeight;
+      const count     = this._visibleProfiles.length;
+      const first =
+          Math.max(0, Math.floor(this._scrollBox.scrollTop / rowHeight) - this._overscan);
+      const last = Math.min(count,
+          Math.ceil((this._scrollBox.scrollTop + this._scrollBox.clientHeight) / rowHeight) +
+              this._overscan);
+
+      const entries = [];
+      for (let i = first; i < last; ++i) {
+        entries.push(this._createEntry(this._visibleProfiles[i], i * rowHeight));
+      }
+
+      this._list.style.position = 'relative';
+      this._list.style.height   = `${count * rowHeight}px`;
+      this._list.replaceChildren(...entries);
+    }
+
+    /**
+     * @param state {string}
+     * @return {string}
+     * @private
+     */
+    _getStateIcon(state) {
+      return state === 'visible' ? 'visibility' : 'visibility_off';
+    }
+
+    /**
+     * @param profile {Object}
+     * @param top {number}
+     * @return {HTMLElement}
+     * @private
+     */
+    _createEntry(profile, top) {
+      const sharad = CosmoScout.gui.loadTemplateContent('sharad');
+
+      sharad.innerHTML = sharad.innerHTML.replace(/%FILE%/g, profile.name)
+                             .replace(/%TIME%/g, profile.time)
+                             .replace(/%STATE_ICON%/g, this._getStateIcon(profile.state))
+                             .trim();
 
-      sharad.classList.add(`item-${file}`);
+      sharad.classList.add(`item-${profile.name}`);
+      sharad.style.position = 'absolute';
+      sharad.style.top      = `${top}px`;
+      sharad.style.left     = '0';
+      sharad.style.right    = '0';
 
-      sharadList.appendChild(sharad);
+      return sharad;
     }
   }
 
@@ -33,14 +33,31 @@ namespace csp::sharad {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Profiles are sent to the user interface in chunks of this size.
+const size_t GUI_BATCH_SIZE = 500;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "filePath", o.mFilePath);
   cs::core::Settings::deserialize(j, "enabled", o.mEnabled);
+  cs::core::Settings::deserialize(j, "showReflectors", o.mShowReflectors);
+  cs::core::Settings::deserialize(j, "reflectorSmoothingRadius", o.mReflectorSmoothingRadius);
+  cs::core::Settings::deserialize(j, "reflectorGradientThreshold", o.mReflectorGradientThreshold);
+  cs::core::Settings::deserialize(j, "reflectorIntensityThreshold", o.mReflectorIntensityThreshold);
+  cs::core::Settings::deserialize(j, "reflectorMinSeparation", o.mReflectorMinSeparation);
+  cs::core::Settings::deserialize(j, "maxReflectors", o.mMaxReflectors);
 }
 
 void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "filePath", o.mFilePath);
   cs::core::Settings::serialize(j, "enabled", o.mEnabled);
+  cs::core::Settings::serialize(j, "showReflectors", o.mShowReflectors);
+  cs::core::Settings::serialize(j, "reflectorSmoothingRadius", o.mReflectorSmoothingRadius);
+  cs::core::Settings::serialize(j, "reflectorGradientThreshold", o.mReflectorGradientThreshold);
+  cs::core::Settings::serialize(j, "reflectorIntensityThreshold", o.mReflectorIntensityThreshold);
+  cs::core::Settings::serialize(j, "reflectorMinSeparation", o.mReflectorMinSeparation);
+  cs::core::Settings::serialize(j, "maxReflectors", o.mMaxReflectors);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,15 +73,60 @@ void Plugin::init() {
 
   mGuiManager->addHtmlToGui("sharad", "../share/resources/gui/sharad-template.html");
 
-  mGuiManager->addScriptToGuiFromJS("../share/resources/gui/js/csp-sharad.js");
-
+  // The tab has to be added first, as the script accesses its elements on initialization.
   mGuiManager->addPluginTabToSideBarFromHTML(
       "SHARAD Profiles", "line_style", "../share/resources/gui/sharad-tab.html");
 
+  mGuiManager->addScriptToGuiFromJS("../share/resources/gui/js/csp-sharad.js");
+
   mGuiManager->getGui()->registerCallback("sharad.setEnabled",
       "Enables or disables the rendering of SHARAD profiles.",
       std::function([this](bool enable) { mPluginSettings.mEnabled = enable; }));
 
+  mGuiManager->getGui()->registerCallback("sharad.setShowReflectors",
+      "Enables or disables the rendering of the extracted surface and subsurface reflectors.",
+      std::function([this](bool enable) { mPluginSettings.mShowReflectors = enable; }));
+
+  mGuiManager->getGui()->registerCallback("sharad.exportReflectors",
+      "Writes the extracted reflectors of each SHARAD profile to a CSV file next to the profile.",
+      std::function([this]() {
+        if (mExportsPending > 0) {
+          mGuiManager->getGui()->callJavascript("CosmoScout.notifications.print",
+              "Export Running", "The reflectors are still being exported.", "error");
+          return;
+        }
+
+        // The reflectors are extracted in the background and each profile reports once its file
+        // has been written.
+        mExportsTotal     = mSharads.size();
+        mExportsPending   = mSharads.size();
+        mExportsSucceeded = 0;
+
+        logger().info("Exporting reflectors of {} profiles...", mExportsTotal);
+
+        if (mSharads.empty()) {
+          onExportFinished();
+          return;
+        }
+
+        for (size_t i = 0; i < mSharads.size(); ++i) {
+          mSharads[i]->exportReflectors(
+              mPluginSettings.mFilePath.get() + mSharadNames[i] + "_reflectors.csv",
+              [this](bool success) {
+                // Profiles which were removed during the export are no longer counted.
+                if (mExportsPending == 0) {
+                  return;
+                }
+
+                mExportsSucceeded += success ? 1 : 0;
+
+                if (--mExportsPending == 0) {
+                  onExportFinished();
+                }
+              });
+        }
+      }));
+
   mPluginSettings.mFilePath.connect([this](std::string const& filePath) {
     // Delete all old Sharad profiles first.
     for (auto const& sharad : mSharads) {
@@ -77,9 +139,16 @@ void Plugin::init() {
 
     mSharads.clear();
     mSharadNodes.clear();
+    mSharadNames.clear();
+    mSharadVisibility.clear();
+
+    // The profiles of a running export are gone.
+    mExportsPending = 0;
 
     // Clear UI list.
-    mGuiManager->getGui()->callJavascript("CosmoScout.gui.clearHtml", "list-sharad");
+    mGuiManager->getGui()->callJavascript("CosmoScout.sharad.clear");
+
+    nlohmann::json batch = nlohmann::json::array();
 
     // Then add new ones.
     boost::filesystem::path               dir(filePath);
@@ -102,16 +171,29 @@ void Plugin::init() {
             VistaOpenSGMaterialTools::SetSortKeyOnSubtree(
                 sharadNode, static_cast<int>(cs::utils::DrawOrder::eOpaqueNonHDR) + 2);
             sharadNode->SetIsEnabled(mPluginSettings.mEnabled.get());
+            sharad->setShowReflectors(mPluginSettings.mShowReflectors.get());
 
             mSharads.push_back(sharad);
             mSharadNodes.emplace_back(sharadNode);
+            mSharadNames.push_back(sName);
+            mSharadVisibility.push_back(false);
+
+            batch.push_back({{"name", sName}, {"time", sharad->getStartExistence() + 10}});
 
-            mGuiManager->getGui()->callJavascript(
-                "CosmoScout.sharad.add", sName, sharad->getStartExistence() + 10);
+            if (batch.size() >= GUI_BATCH_SIZE) {
+              mGuiManager->getGui()->callJavascript("CosmoScout.sharad.add", batch.dump());
+              batch = nlohmann::json::array();
+            }
           }
         }
       }
     }
+
+    if (!batch.empty()) {
+      mGuiManager->getGui()->callJavascript("CosmoScout.sharad.add", batch.dump());
+    }
+
+    updateReflectorSettings();
   });
 
   mPluginSettings.mEnabled.connectAndTouch([this](bool val) {
@@ -120,6 +202,20 @@ void Plugin::init() {
     }
   });
 
+  mPluginSettings.mShowReflectors.connect([this](bool val) {
+    for (auto const& sharad : mSharads) {
+      sharad->setShowReflectors(val);
+    }
+  });
+
+  mPluginSettings.mReflectorSmoothingRadius.connect([this](int) { updateReflectorSettings(); });
+  mPluginSettings.mReflectorGradientThreshold.connect(
+      [this](float) { updateReflectorSettings(); });
+  mPluginSettings.mReflectorIntensityThreshold.connect(
+      [this](float) { updateReflectorSettings(); });
+  mPluginSettings.mReflectorMinSeparation.connect([this](int) { updateReflectorSettings(); });
+  mPluginSettings.mMaxReflectors.connect([this](int) { updateReflectorSettings(); });
+
   mActiveBodyConnection = mSolarSystem->pActiveBody.connectAndTouch(
       [this](std::shared_ptr<cs::scene::CelestialBody> const& body) {
         bool enabled = false;
@@ -155,6 +251,8 @@ void Plugin::deInit() {
 
   mSolarSystem->pActiveBody.disconnect(mActiveBodyConnection);
   mGuiManager->getGui()->unregisterCallback("sharad.setEnabled");
+  mGuiManager->getGui()->unregisterCallback("sharad.setShowReflectors");
+  mGuiManager->getGui()->unregisterCallback("sharad.exportReflectors");
   mGuiManager->getGui()->callJavascript("CosmoScout.gui.unregisterHtml", "sharad");
 
   mAllSettings->onLoad().disconnect(mOnLoadConnection);
@@ -165,6 +263,26 @@ void Plugin::deInit() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Plugin::update() {
+  // Collect all changes of the profiles' visibility and send them at once.
+  nlohmann::json delta = nlohmann::json::object();
+
+  for (size_t i = 0; i < mSharads.size(); ++i) {
+    bool visible = mPluginSettings.mEnabled.get() && mSharads[i]->getIsInExistence();
+
+    if (visible != mSharadVisibility[i]) {
+      mSharadVisibility[i]   = visible;
+      delta[mSharadNames[i]] = visible ? "visible" : "loaded";
+    }
+  }
+
+  if (!delta.empty()) {
+    mGuiManager->getGui()->callJavascript("CosmoScout.sharad.setStates", delta.dump());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Plugin::onLoad() {
   // Read settings from JSON.
   from_json(mAllSettings->mPlugins.at("csp-sharad"), mPluginSettings);
@@ -172,4 +290,31 @@ void Plugin::onLoad() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Plugin::updateReflectorSettings() {
+  ReflectorExtractor::Settings settings;
+  settings.mSmoothingRadius    = mPluginSettings.mReflectorSmoothingRadius.get();
+  settings.mGradientThreshold  = mPluginSettings.mReflectorGradientThreshold.get();
+  settings.mIntensityThreshold = mPluginSettings.mReflectorIntensityThreshold.get();
+  settings.mMinSeparation      = mPluginSettings.mReflectorMinSeparation.get();
+  settings.mMaxReflectors      = mPluginSettings.mMaxReflectors.get();
+
+  for (auto const& sharad : mSharads) {
+    sharad->setReflectorSettings(settings);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::onExportFinished() {
+  logger().info("Exported reflectors of {} of {} profiles to '{}'.", mExportsSucceeded,
+      mExportsTotal, mPluginSettings.mFilePath.get());
+
+  mGuiManager->getGui()->callJavascript("CosmoScout.notifications.print", "Reflectors Exported",
+      "Exported " + std::to_string(mExportsSucceeded) + " of " + std::to_string(mExportsTotal) +
+          " profiles.",
+      mExportsSucceeded == mExportsTotal ? "save_alt" : "error");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 } // namespace csp::sharad
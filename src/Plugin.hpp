@@ -23,17 +23,39 @@ class Plugin : public cs::core::PluginBase {
   struct Settings {
     cs::utils::Property<std::string> mFilePath;
     cs::utils::DefaultProperty<bool> mEnabled{false};
+
+    /// Surface and subsurface reflector extraction. See ReflectorExtractor::Settings for details.
+    cs::utils::DefaultProperty<bool>  mShowReflectors{false};
+    cs::utils::DefaultProperty<int>   mReflectorSmoothingRadius{3};
+    cs::utils::DefaultProperty<float> mReflectorGradientThreshold{0.02F};
+    cs::utils::DefaultProperty<float> mReflectorIntensityThreshold{0.1F};
+    cs::utils::DefaultProperty<int>   mReflectorMinSeparation{10};
+    cs::utils::DefaultProperty<int>   mMaxReflectors{4};
   };
 
   void init() override;
   void deInit() override;
+  void update() override;
 
  private:
   void onLoad();
+  void updateReflectorSettings();
+
+  /// Reports the result of an export once all profiles have written their reflectors.
+  void onExportFinished();
 
   Settings                                      mPluginSettings;
   std::vector<std::shared_ptr<Sharad>>          mSharads;
   std::vector<std::unique_ptr<VistaOpenGLNode>> mSharadNodes;
+  std::vector<std::string>                      mSharadNames;
+
+  /// The visibility of each profile as last reported to the user interface.
+  std::vector<bool> mSharadVisibility;
+
+  /// The progress of the current reflector export.
+  size_t mExportsTotal     = 0;
+  size_t mExportsPending   = 0;
+  size_t mExportsSucceeded = 0;
 
   int mActiveBodyConnection = -1;
   int mOnLoadConnection     = -1;
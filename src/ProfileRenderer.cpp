@@ -0,0 +1,418 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ProfileRenderer.hpp"
+
+#include <VistaOGLExt/VistaTexture.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace csp::sharad {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<VistaGLSLShader> ProfileRenderer::mShader          = nullptr;
+std::unique_ptr<VistaGLSLShader> ProfileRenderer::mReflectorShader = nullptr;
+int                              ProfileRenderer::mInstanceCount   = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* ProfileRenderer::VERT = R"(
+#version 330
+
+uniform mat4 uMatModelView;
+uniform mat4 uMatProjection;
+uniform float uHeightScale;
+uniform float uRadius;
+
+// inputs
+layout(location = 0) in vec3  iPosition;
+layout(location = 1) in vec2  iTexCoords;
+layout(location = 2) in float iTime;
+
+// outputs
+out vec3  vPosition;
+out vec2  vTexCoords;
+out float vTime;
+
+void main()
+{
+    vTexCoords = iTexCoords;
+    vTime      = iTime;
+
+    float height = vTexCoords.y < 0.5 ? 
+                        uRadius + 10000 * uHeightScale : 
+                        uRadius - 10100 * uHeightScale ;
+
+    vPosition   = (uMatModelView * vec4(iPosition * height, 1.0)).xyz;
+    gl_Position =  uMatProjection * vec4(vPosition, 1);
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* ProfileRenderer::FRAG = R"(
+#version 330
+
+uniform sampler2DRect uDepthBuffer;
+uniform sampler2D uSharadTexture;
+uniform float uAmbientBrightness;
+uniform float uTime;
+uniform float uSceneScale;
+uniform float uFarClip;
+uniform vec2 uViewportPos;
+
+// inputs
+in vec3  vPosition;
+in vec2  vTexCoords;
+in float vTime;
+
+// outputs
+layout(location = 0) out vec4 oColor;
+
+void main()
+{
+    if (vTime > uTime)
+    {
+        discard;
+    }
+
+    float sharadDistance  = length(vPosition);
+    float surfaceDistance = texture(uDepthBuffer, gl_FragCoord.xy - uViewportPos).r * uFarClip;
+    
+    if (sharadDistance < surfaceDistance)
+    {
+        discard;
+    }
+
+    float val = texture(uSharadTexture, vTexCoords).r;
+    val = mix(1, val, clamp((uTime - vTime), 0, 1));
+
+    oColor.r = pow(val,  0.5);
+    oColor.g = pow(val,  2.0);
+    oColor.b = pow(val, 10.0);
+    oColor.a = 1.0 - clamp((sharadDistance - surfaceDistance) * uSceneScale / 30000, 0.1, 1.0);
+
+    gl_FragDepth = sharadDistance / uFarClip;
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* ProfileRenderer::REFLECTOR_VERT = R"(
+#version 330
+
+uniform mat4 uMatModelView;
+uniform mat4 uMatProjection;
+uniform float uHeightScale;
+uniform float uRadius;
+
+// inputs
+layout(location = 0) in vec3  iPosition;
+layout(location = 1) in float iDepth;
+layout(location = 2) in float iTime;
+layout(location = 3) in float iReflector;
+
+// outputs
+out vec3  vPosition;
+out float vTime;
+out float vReflector;
+
+void main()
+{
+    vTime      = iTime;
+    vReflector = iReflector;
+
+    // This has to match the vertical extent of the radargram in VERT.
+    float height = mix(uRadius + 10000 * uHeightScale, uRadius - 10100 * uHeightScale, iDepth);
+
+    vPosition   = (uMatModelView * vec4(iPosition * height, 1.0)).xyz;
+    gl_Position =  uMatProjection * vec4(vPosition, 1);
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* ProfileRenderer::REFLECTOR_FRAG = R"(
+#version 330
+
+uniform sampler2DRect uDepthBuffer;
+uniform float uTime;
+uniform float uFarClip;
+uniform vec2 uViewportPos;
+
+// inputs
+in vec3  vPosition;
+in float vTime;
+in float vReflector;
+
+// outputs
+layout(location = 0) out vec4 oColor;
+
+void main()
+{
+    if (vTime > uTime)
+    {
+        discard;
+    }
+
+    float reflectorDistance = length(vPosition);
+    float surfaceDistance   = texture(uDepthBuffer, gl_FragCoord.xy - uViewportPos).r * uFarClip;
+    
+    if (reflectorDistance < surfaceDistance)
+    {
+        discard;
+    }
+
+    // The surface reflector is drawn in cyan, all subsurface reflectors in yellow.
+    oColor = vReflector < 0.5 ? vec4(0.2, 0.9, 1.0, 1.0) : vec4(1.0, 0.8, 0.1, 1.0);
+
+    gl_FragDepth = reflectorDistance / uFarClip;
+}
+)";
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ProfileRenderer::ProfileRenderer() {
+  if (mInstanceCount == 0) {
+    mShader = std::make_unique<VistaGLSLShader>();
+    mShader->InitVertexShaderFromString(VERT);
+    mShader->InitFragmentShaderFromString(FRAG);
+    mShader->Link();
+  }
+
+  ++mInstanceCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ProfileRenderer::~ProfileRenderer() {
+  --mInstanceCount;
+
+  if (mInstanceCount == 0) {
+    mShader.reset(nullptr);
+    mReflectorShader.reset(nullptr);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileRenderer::setSamples(std::vector<glm::vec3> positions, std::vector<float> times) {
+  mPositions = std::move(positions);
+  mTimes     = std::move(times);
+
+  struct Vertex {
+    glm::vec3 pos;
+    glm::vec2 tc;
+    float     time;
+  };
+
+  auto                samples = static_cast<int>(mPositions.size());
+  std::vector<Vertex> vertices(samples * 2);
+
+  for (int i = 0; i < samples; ++i) {
+    float x = 1.F * static_cast<float>(i) / (static_cast<float>(samples) - 1.F);
+
+    vertices[i * 2 + 0].pos  = mPositions[i];
+    vertices[i * 2 + 0].tc   = glm::vec2(x, 1.F);
+    vertices[i * 2 + 0].time = mTimes[i];
+    vertices[i * 2 + 1].pos  = mPositions[i];
+    vertices[i * 2 + 1].tc   = glm::vec2(x, 0.F);
+    vertices[i * 2 + 1].time = mTimes[i];
+  }
+
+  mVBO.Bind(GL_ARRAY_BUFFER);
+  mVBO.BufferData(vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  mVBO.Release();
+
+  mVAO.EnableAttributeArray(0);
+  mVAO.SpecifyAttributeArrayFloat(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0, &mVBO);
+
+  mVAO.EnableAttributeArray(1);
+  mVAO.SpecifyAttributeArrayFloat(
+      1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<GLuint>(offsetof(Vertex, tc)), &mVBO);
+
+  mVAO.EnableAttributeArray(2);
+  mVAO.SpecifyAttributeArrayFloat(
+      2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<GLuint>(offsetof(Vertex, time)), &mVBO);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileRenderer::setReflectors(ReflectorExtractor::Result const& reflectors) {
+  // The reflector program is only required once any reflectors have been extracted.
+  if (!mReflectorShader) {
+    mReflectorShader = std::make_unique<VistaGLSLShader>();
+    mReflectorShader->InitVertexShaderFromString(REFLECTOR_VERT);
+    mReflectorShader->InitFragmentShaderFromString(REFLECTOR_FRAG);
+    mReflectorShader->Link();
+  }
+
+  // Each pair of adjacent samples where a reflector was found in both becomes a line segment.
+  struct Vertex {
+    glm::vec3 pos;
+    float     depth;
+    float     time;
+    float     reflector;
+  };
+
+  std::vector<Vertex> vertices;
+
+  auto samples = static_cast<int>(mPositions.size());
+
+  auto getColumn = [&](int i) {
+    float x = 1.F * static_cast<float>(i) / (static_cast<float>(samples) - 1.F);
+    return static_cast<int>(std::round(x * static_cast<float>(reflectors.mWidth - 1)));
+  };
+
+  for (int r = 0; r < reflectors.mMaxReflectors && reflectors.mWidth > 0; ++r) {
+    for (int i = 0; i + 1 < samples; ++i) {
+      float depthA = reflectors.getDepth(getColumn(i), r);
+      float depthB = reflectors.getDepth(getColumn(i + 1), r);
+
+      if (depthA >= 0.F && depthB >= 0.F) {
+        vertices.push_back({mPositions[i], depthA, mTimes[i], static_cast<float>(r)});
+        vertices.push_back({mPositions[i + 1], depthB, mTimes[i + 1], static_cast<float>(r)});
+      }
+    }
+  }
+
+  mReflectorVertexCount = static_cast<int>(vertices.size());
+
+  mReflectorVBO.Bind(GL_ARRAY_BUFFER);
+  mReflectorVBO.BufferData(vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+  mReflectorVBO.Release();
+
+  mReflectorVAO.EnableAttributeArray(0);
+  mReflectorVAO.SpecifyAttributeArrayFloat(
+      0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0, &mReflectorVBO);
+
+  mReflectorVAO.EnableAttributeArray(1);
+  mReflectorVAO.SpecifyAttributeArrayFloat(1, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+      static_cast<GLuint>(offsetof(Vertex, depth)), &mReflectorVBO);
+
+  mReflectorVAO.EnableAttributeArray(2);
+  mReflectorVAO.SpecifyAttributeArrayFloat(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+      static_cast<GLuint>(offsetof(Vertex, time)), &mReflectorVBO);
+
+  mReflectorVAO.EnableAttributeArray(3);
+  mReflectorVAO.SpecifyAttributeArrayFloat(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+      static_cast<GLuint>(offsetof(Vertex, reflector)), &mReflectorVBO);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ProfileRenderer::Statistics ProfileRenderer::draw(Uniforms const& uniforms,
+    VistaTexture* radargram, VistaTexture* depthBuffer, bool drawReflectors) {
+
+  Statistics statistics;
+
+  mShader->Bind();
+
+  glUniformMatrix4fv(mShader->GetUniformLocation("uMatModelView"), 1, GL_FALSE,
+      glm::value_ptr(uniforms.mModelView));
+  glUniformMatrix4fv(mShader->GetUniformLocation("uMatProjection"), 1, GL_FALSE,
+      glm::value_ptr(uniforms.mProjection));
+  mShader->SetUniform(mShader->GetUniformLocation("uViewportPos"), uniforms.mViewportPos.x,
+      uniforms.mViewportPos.y);
+
+  mShader->SetUniform(mShader->GetUniformLocation("uSharadTexture"), 0);
+  mShader->SetUniform(mShader->GetUniformLocation("uDepthBuffer"), 1);
+  mShader->SetUniform(mShader->GetUniformLocation("uSceneScale"), uniforms.mSceneScale);
+  mShader->SetUniform(mShader->GetUniformLocation("uHeightScale"), uniforms.mHeightScale);
+  mShader->SetUniform(mShader->GetUniformLocation("uRadius"), uniforms.mRadius);
+  mShader->SetUniform(mShader->GetUniformLocation("uTime"), uniforms.mTime);
+  mShader->SetUniform(mShader->GetUniformLocation("uFarClip"), uniforms.mFarClip);
+
+  radargram->Bind(GL_TEXTURE0);
+  depthBuffer->Bind(GL_TEXTURE1);
+
+  glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
+
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // glDepthFunc(GL_GEQUAL);
+  // glDepthMask(false);
+  glDisable(GL_DEPTH_TEST);
+
+  // draw --------------------------------------------------------------------
+  auto curtainVertices = static_cast<int>(mPositions.size() * 2);
+
+  mVAO.Bind();
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, curtainVertices);
+  mVAO.Release();
+
+  ++statistics.mDrawCalls;
+  statistics.mVertices += curtainVertices;
+
+  mShader->Release();
+
+  // draw reflectors ---------------------------------------------------------
+  if (drawReflectors && mReflectorVertexCount > 0) {
+    mReflectorShader->Bind();
+
+    glUniformMatrix4fv(mReflectorShader->GetUniformLocation("uMatModelView"), 1, GL_FALSE,
+        glm::value_ptr(uniforms.mModelView));
+    glUniformMatrix4fv(mReflectorShader->GetUniformLocation("uMatProjection"), 1, GL_FALSE,
+        glm::value_ptr(uniforms.mProjection));
+    mReflectorShader->SetUniform(mReflectorShader->GetUniformLocation("uViewportPos"),
+        uniforms.mViewportPos.x, uniforms.mViewportPos.y);
+    mReflectorShader->SetUniform(mReflectorShader->GetUniformLocation("uDepthBuffer"), 1);
+    mReflectorShader->SetUniform(
+        mReflectorShader->GetUniformLocation("uHeightScale"), uniforms.mHeightScale);
+    mReflectorShader->SetUniform(mReflectorShader->GetUniformLocation("uRadius"), uniforms.mRadius);
+    mReflectorShader->SetUniform(mReflectorShader->GetUniformLocation("uTime"), uniforms.mTime);
+    mReflectorShader->SetUniform(
+        mReflectorShader->GetUniformLocation("uFarClip"), uniforms.mFarClip);
+
+    mReflectorVAO.Bind();
+    glDrawArrays(GL_LINES, 0, mReflectorVertexCount);
+    mReflectorVAO.Release();
+
+    ++statistics.mDrawCalls;
+    statistics.mVertices += mReflectorVertexCount;
+
+    mReflectorShader->Release();
+  }
+
+  // clean up ----------------------------------------------------------------
+  radargram->Unbind(GL_TEXTURE0);
+
+  glPopAttrib();
+
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<VistaTexture> ProfileRenderer::createDepthBuffer() {
+  auto depthBuffer = std::make_unique<VistaTexture>(GL_TEXTURE_RECTANGLE);
+  depthBuffer->Bind();
+  depthBuffer->SetWrapS(GL_CLAMP);
+  depthBuffer->SetWrapT(GL_CLAMP);
+  depthBuffer->SetMinFilter(GL_NEAREST);
+  depthBuffer->SetMagFilter(GL_NEAREST);
+  depthBuffer->Unbind();
+  return depthBuffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ProfileRenderer::copyDepthBuffer(VistaTexture* depthBuffer) {
+  std::array<GLint, 4> iViewport{};
+  glGetIntegerv(GL_VIEWPORT, iViewport.data());
+  depthBuffer->Bind();
+  glCopyTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_DEPTH_COMPONENT, iViewport.at(0), iViewport.at(1),
+      iViewport.at(2), iViewport.at(3), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::sharad
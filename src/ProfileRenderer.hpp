@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_SHARAD_PROFILE_RENDERER_HPP
+#define CSP_SHARAD_PROFILE_RENDERER_HPP
+
+#include "ReflectorExtractor.hpp"
+
+#include <VistaOGLExt/VistaBufferObject.h>
+#include <VistaOGLExt/VistaGLSLShader.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+class VistaTexture;
+
+namespace csp::sharad {
+
+/// Owns the OpenGL resources of a single SHARAD profile and draws its curtain and reflectors. It
+/// does not depend on the scene graph or on SPICE, so that the rendering can also be exercised by
+/// the headless performance test. The shader programs are shared by all instances.
+class ProfileRenderer {
+ public:
+  /// All values which are passed to the shaders.
+  struct Uniforms {
+    glm::mat4 mModelView{1.F};
+    glm::mat4 mProjection{1.F};
+    glm::vec2 mViewportPos{0.F};
+    float     mHeightScale = 1.F;
+    float     mRadius      = 1.F;
+    float     mTime        = 0.F;
+    float     mSceneScale  = 1.F;
+    float     mFarClip     = 1.F;
+  };
+
+  /// The work issued by draw().
+  struct Statistics {
+    int mDrawCalls = 0;
+    int mVertices  = 0;
+  };
+
+  ProfileRenderer();
+
+  ProfileRenderer(ProfileRenderer const& other) = delete;
+  ProfileRenderer(ProfileRenderer&& other)      = delete;
+
+  ProfileRenderer& operator=(ProfileRenderer const& other) = delete;
+  ProfileRenderer& operator=(ProfileRenderer&& other) = delete;
+
+  ~ProfileRenderer();
+
+  /// Creates the curtain geometry. The positions of the samples are given on the unit sphere, the
+  /// times are relative to the first sample.
+  void setSamples(std::vector<glm::vec3> positions, std::vector<float> times);
+
+  /// Creates the line geometry of the given reflectors. Each radargram column is mapped to the
+  /// nearest sample of the profile.
+  void setReflectors(ReflectorExtractor::Result const& reflectors);
+
+  /// Draws the curtain with the given radargram and optionally the reflectors. The depth buffer
+  /// has to contain a copy of the scene's depth made with copyDepthBuffer().
+  Statistics draw(Uniforms const& uniforms, VistaTexture* radargram, VistaTexture* depthBuffer,
+      bool drawReflectors);
+
+  /// Creates a texture which can be used with copyDepthBuffer().
+  static std::unique_ptr<VistaTexture> createDepthBuffer();
+
+  /// Copies the depth buffer of the current viewport into the given texture.
+  static void copyDepthBuffer(VistaTexture* depthBuffer);
+
+ private:
+  static std::unique_ptr<VistaGLSLShader> mShader;
+  static std::unique_ptr<VistaGLSLShader> mReflectorShader;
+  static int                              mInstanceCount;
+
+  VistaVertexArrayObject mVAO;
+  VistaBufferObject      mVBO;
+
+  VistaVertexArrayObject mReflectorVAO;
+  VistaBufferObject      mReflectorVBO;
+
+  std::vector<glm::vec3> mPositions;
+  std::vector<float>     mTimes;
+  int                    mReflectorVertexCount = 0;
+
+  static const char* VERT;
+  static const char* FRAG;
+  static const char* REFLECTOR_VERT;
+  static const char* REFLECTOR_FRAG;
+};
+
+} // namespace csp::sharad
+
+#endif // CSP_SHARAD_PROFILE_RENDERER_HPP
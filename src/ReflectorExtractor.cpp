@@ -0,0 +1,228 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ReflectorExtractor.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace csp::sharad {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Gradients which differ by less than this are considered equal. Box filtering a step edge results
+// in a plateau of equal gradients which would otherwise be broken up by rounding errors.
+const float EPSILON = 1e-5F;
+
+// Flags computed for each pixel by classifyRow().
+const uint8_t PEAK_START = 1; // The gradient rises above the threshold and does not rise further.
+const uint8_t PEAK_END   = 2; // The gradient drops in the next row.
+const uint8_t RISING     = 4; // The gradient rises in the next row.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The following kernels work on n consecutive values without any branches in their loop bodies.
+// This allows the compiler to vectorize them.
+
+void addRow(float* sum, uint8_t const* row, int n) {
+  for (int i = 0; i < n; ++i) {
+    sum[i] += static_cast<float>(row[i]);
+  }
+}
+
+void subtractRow(float* sum, uint8_t const* row, int n) {
+  for (int i = 0; i < n; ++i) {
+    sum[i] -= static_cast<float>(row[i]);
+  }
+}
+
+void scaleRow(float* out, float const* sum, float factor, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = sum[i] * factor;
+  }
+}
+
+void gradientRow(float* out, float const* above, float const* below, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = below[i] - above[i];
+  }
+}
+
+void classifyRow(uint8_t* out, float const* gradAbove, float const* grad, float const* gradBelow,
+    float gradientThreshold, int n) {
+  for (int i = 0; i < n; ++i) {
+    int rising = static_cast<int>(grad[i] < gradBelow[i] - EPSILON);
+    int start  = static_cast<int>(grad[i] >= gradientThreshold) &
+                static_cast<int>(grad[i] > gradAbove[i] + EPSILON) & (rising ^ 1);
+    int end = static_cast<int>(grad[i] > gradBelow[i] + EPSILON);
+
+    out[i] = static_cast<uint8_t>(start * PEAK_START + end * PEAK_END + rising * RISING);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReflectorExtractor::Result ReflectorExtractor::createResult(
+    int width, int height, Settings const& settings) {
+  Result result;
+  result.mWidth         = std::max(0, width);
+  result.mHeight        = std::max(0, height);
+  result.mMaxReflectors = std::max(0, settings.mMaxReflectors);
+  result.mDepths.resize(static_cast<size_t>(result.mWidth) * result.mMaxReflectors, -1.F);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ReflectorExtractor::extractColumns(std::vector<uint8_t> const& radargram,
+    Settings const& settings, int startColumn, int endColumn, Result& result) {
+
+  int const width  = result.mWidth;
+  int const height = result.mHeight;
+
+  startColumn = std::max(0, startColumn);
+  endColumn   = std::min(width, endColumn);
+
+  // At least five rows are required to find a local maximum of the centered gradient.
+  if (startColumn >= endColumn || height < 5 || result.mMaxReflectors == 0 ||
+      radargram.size() < static_cast<size_t>(width) * height) {
+    return;
+  }
+
+  int const      n      = endColumn - startColumn;
+  int const      radius = std::max(0, settings.mSmoothingRadius);
+  uint8_t const* input  = radargram.data() + startColumn;
+
+  auto row = [&](int r) { return input + static_cast<size_t>(r) * width; };
+
+  // smooth along the depth axis with a sliding box filter ---------------------------------------
+  // The intensities are mapped to [0, 1] in the same step.
+  std::vector<float> smoothed(static_cast<size_t>(n) * height);
+  std::vector<float> sum(n, 0.F);
+
+  int windowEnd = std::min(radius, height - 1);
+  for (int r = 0; r <= windowEnd; ++r) {
+    addRow(sum.data(), row(r), n);
+  }
+
+  int windowSize = windowEnd + 1;
+
+  for (int r = 0; r < height; ++r) {
+    scaleRow(&smoothed[static_cast<size_t>(r) * n], sum.data(), 1.F / (255.F * windowSize), n);
+
+    if (r + radius + 1 < height) {
+      addRow(sum.data(), row(r + radius + 1), n);
+      ++windowSize;
+    }
+
+    if (r - radius >= 0) {
+      subtractRow(sum.data(), row(r - radius), n);
+      --windowSize;
+    }
+  }
+
+  // detect gradient peaks -----------------------------------------------------------------------
+  // A step edge results in a plateau of maximum gradients which is about twice the filter radius
+  // wide. Therefore the start of such a plateau is remembered and the reflector is placed at its
+  // center once the gradient drops again. As the center lies on the transition between a dark and
+  // a bright row, the reflector is reported at the first bright row, half a row further down.
+  auto smoothedRow = [&](int r) { return &smoothed[static_cast<size_t>(r) * n]; };
+
+  std::vector<float>   gradAbove(n);
+  std::vector<float>   grad(n);
+  std::vector<float>   gradBelow(n);
+  std::vector<uint8_t> flags(n);
+  std::vector<int>     found(n, 0);
+  std::vector<float>   lastRow(n, 0.F);
+  std::vector<int>     plateauStart(n, -1);
+
+  auto addReflector = [&](int i, int plateauEnd) {
+    float reflectorRow = 0.5F * static_cast<float>(plateauStart[i] + plateauEnd) + 0.5F;
+
+    float intensity = smoothedRow(static_cast<int>(reflectorRow))[i];
+
+    if (found[i] < settings.mMaxReflectors && intensity >= settings.mIntensityThreshold &&
+        (found[i] == 0 ||
+            reflectorRow - lastRow[i] >= static_cast<float>(settings.mMinSeparation))) {
+      result.mDepths[(startColumn + i) * result.mMaxReflectors + found[i]] =
+          (reflectorRow + 0.5F) / static_cast<float>(height);
+      lastRow[i] = reflectorRow;
+      ++found[i];
+    }
+
+    plateauStart[i] = -1;
+  };
+
+  gradientRow(grad.data(), smoothedRow(0), smoothedRow(2), n);
+  gradientRow(gradBelow.data(), smoothedRow(1), smoothedRow(3), n);
+
+  for (int r = 2; r < height - 2; ++r) {
+    std::swap(gradAbove, grad);
+    std::swap(grad, gradBelow);
+    gradientRow(gradBelow.data(), smoothedRow(r), smoothedRow(r + 2), n);
+
+    classifyRow(flags.data(), gradAbove.data(), grad.data(), gradBelow.data(),
+        settings.mGradientThreshold, n);
+
+    for (int i = 0; i < n; ++i) {
+      if (plateauStart[i] < 0) {
+        if (flags[i] & PEAK_START) {
+          plateauStart[i] = r;
+
+          if (flags[i] & PEAK_END) {
+            addReflector(i, r);
+          }
+        }
+      } else if (flags[i] & PEAK_END) {
+        addReflector(i, r);
+      } else if (flags[i] & RISING) {
+        // This was not a maximum after all.
+        plateauStart[i] = -1;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ReflectorExtractor::Result ReflectorExtractor::extract(std::vector<uint8_t> const& radargram,
+    int width, int height, Settings const& settings, unsigned threadCount) {
+
+  Result result = createResult(width, height, settings);
+
+  if (threadCount == 0) {
+    threadCount = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  int const blockSize = std::max(
+      MIN_BLOCK_SIZE, (width + static_cast<int>(threadCount) - 1) / static_cast<int>(threadCount));
+
+  std::vector<std::thread> threads;
+
+  for (int startColumn = blockSize; startColumn < width; startColumn += blockSize) {
+    threads.emplace_back(extractColumns, std::cref(radargram), std::cref(settings), startColumn,
+        startColumn + blockSize, std::ref(result));
+  }
+
+  // The first block is processed on the calling thread.
+  extractColumns(radargram, settings, 0, blockSize, result);
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::sharad
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_SHARAD_REFLECTOR_EXTRACTOR_HPP
+#define CSP_SHARAD_REFLECTOR_EXTRACTOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace csp::sharad {
+
+/// Extracts the surface and subsurface reflectors from a radargram. Each column of the radargram
+/// is smoothed along the depth axis, the vertical gradient of the smoothed signal is computed and
+/// strong positive gradient peaks (dark to bright transitions) are reported as reflectors. Each
+/// reflector is placed at the first bright row below such a transition. The first reflector of
+/// each column is the surface, all following ones are subsurface reflectors.
+///
+/// All kernels operate on whole radargram rows, so the inner loops run over contiguous memory and
+/// are vectorized by the compiler. The columns are split into blocks which can be processed in
+/// parallel.
+class ReflectorExtractor {
+ public:
+  struct Settings {
+    /// Radius of the box filter which is applied along the depth axis in pixels.
+    int mSmoothingRadius = 3;
+
+    /// Minimum gradient of the smoothed signal for a peak to be considered a reflector. The
+    /// radargram intensities are mapped to the range [0, 1] for this.
+    float mGradientThreshold = 0.02F;
+
+    /// Minimum smoothed intensity at the row of a reflector.
+    float mIntensityThreshold = 0.1F;
+
+    /// Minimum distance between two reflectors of the same column in pixels.
+    int mMinSeparation = 10;
+
+    /// Maximum number of reflectors which are reported per column, including the surface.
+    int mMaxReflectors = 4;
+  };
+
+  struct Result {
+    int mWidth         = 0;
+    int mHeight        = 0;
+    int mMaxReflectors = 0;
+
+    /// Contains mMaxReflectors entries per column. Each entry is the normalized depth of the
+    /// reflector in the range [0, 1] or a negative value if there is no such reflector. A depth d
+    /// corresponds to the radargram row d * mHeight - 0.5.
+    std::vector<float> mDepths;
+
+    float getDepth(int column, int reflector) const {
+      return mDepths[column * mMaxReflectors + reflector];
+    }
+  };
+
+  /// Columns are processed in blocks of at least this size.
+  static constexpr int MIN_BLOCK_SIZE = 64;
+
+  /// Creates a result of the given size where all reflectors are missing.
+  static Result createResult(int width, int height, Settings const& settings);
+
+  /// Extracts the reflectors of the columns [startColumn, endColumn) and stores them in the given
+  /// result, which has to be created with createResult(). The radargram is given row by row,
+  /// starting with the top-most row. Disjoint column ranges of the same result may be processed
+  /// concurrently.
+  static void extractColumns(std::vector<uint8_t> const& radargram, Settings const& settings,
+      int startColumn, int endColumn, Result& result);
+
+  /// Extracts the reflectors of all columns using the given amount of threads. The amount of
+  /// threads defaults to the number of hardware threads.
+  static Result extract(std::vector<uint8_t> const& radargram, int width, int height,
+      Settings const& settings, unsigned threadCount = 0);
+};
+
+} // namespace csp::sharad
+
+#endif // CSP_SHARAD_REFLECTOR_EXTRACTOR_HPP
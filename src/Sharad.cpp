@@ -10,6 +10,7 @@
 #include "../../../src/cs-graphics/TextureLoader.hpp"
 #include "../../../src/cs-scene/CelestialObserver.hpp"
 #include "../../../src/cs-utils/FrameTimings.hpp"
+#include "../../../src/cs-utils/ThreadPool.hpp"
 #include "../../../src/cs-utils/convert.hpp"
 #include "../../../src/cs-utils/utils.hpp"
 #include "logger.hpp"
@@ -20,99 +21,23 @@
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <fstream>
+#include <thread>
 #include <utility>
 
 namespace csp::sharad {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-const char* Sharad::VERT = R"(
-#version 330
-
-uniform mat4 uMatModelView;
-uniform mat4 uMatProjection;
-uniform float uHeightScale;
-uniform float uRadius;
-
-// inputs
-layout(location = 0) in vec3  iPosition;
-layout(location = 1) in vec2  iTexCoords;
-layout(location = 2) in float iTime;
-
-// outputs
-out vec3  vPosition;
-out vec2  vTexCoords;
-out float vTime;
-
-void main()
-{
-    vTexCoords = iTexCoords;
-    vTime      = iTime;
-
-    float height = vTexCoords.y < 0.5 ? 
-                        uRadius + 10000 * uHeightScale : 
-                        uRadius - 10100 * uHeightScale ;
-
-    vPosition   = (uMatModelView * vec4(iPosition * height, 1.0)).xyz;
-    gl_Position =  uMatProjection * vec4(vPosition, 1);
-}
-)";
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-const char* Sharad::FRAG = R"(
-#version 330
-
-uniform sampler2DRect uDepthBuffer;
-uniform sampler2D uSharadTexture;
-uniform float uAmbientBrightness;
-uniform float uTime;
-uniform float uSceneScale;
-uniform float uFarClip;
-uniform vec2 uViewportPos;
-
-// inputs
-in vec3  vPosition;
-in vec2  vTexCoords;
-in float vTime;
-
-// outputs
-layout(location = 0) out vec4 oColor;
-
-void main()
-{
-    if (vTime > uTime)
-    {
-        discard;
-    }
-
-    float sharadDistance  = length(vPosition);
-    float surfaceDistance = texture(uDepthBuffer, gl_FragCoord.xy - uViewportPos).r * uFarClip;
-    
-    if (sharadDistance < surfaceDistance)
-    {
-        discard;
-    }
-
-    float val = texture(uSharadTexture, vTexCoords).r;
-    val = mix(1, val, clamp((uTime - vTime), 0, 1));
-
-    oColor.r = pow(val,  0.5);
-    oColor.g = pow(val,  2.0);
-    oColor.b = pow(val, 10.0);
-    oColor.a = 1.0 - clamp((sharadDistance - surfaceDistance) * uSceneScale / 30000, 0.1, 1.0);
-
-    gl_FragDepth = sharadDistance / uFarClip;
-}
-)";
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-std::unique_ptr<VistaTexture>                Sharad::mDepthBuffer     = nullptr;
-std::unique_ptr<Sharad::FramebufferCallback> Sharad::mPreCallback     = nullptr;
-std::unique_ptr<VistaOpenGLNode>             Sharad::mPreCallbackNode = nullptr;
-int                                          Sharad::mInstanceCount   = 0;
+std::unique_ptr<VistaTexture>                Sharad::mDepthBuffer            = nullptr;
+std::unique_ptr<Sharad::FramebufferCallback> Sharad::mPreCallback            = nullptr;
+std::unique_ptr<VistaOpenGLNode>             Sharad::mPreCallbackNode        = nullptr;
+int                                          Sharad::mInstanceCount          = 0;
+std::unique_ptr<cs::utils::ThreadPool>       Sharad::mThreadPool             = nullptr;
+bool                                         Sharad::mRadargramReadThisFrame = false;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -146,13 +71,7 @@ Sharad::Sharad(std::shared_ptr<cs::core::Settings> settings, std::string const&
   mEndExistence = cs::utils::convert::time::toSpice("2040-01-01T00:00:00.000Z");
 
   if (mInstanceCount == 0) {
-    mDepthBuffer = std::make_unique<VistaTexture>(GL_TEXTURE_RECTANGLE);
-    mDepthBuffer->Bind();
-    mDepthBuffer->SetWrapS(GL_CLAMP);
-    mDepthBuffer->SetWrapT(GL_CLAMP);
-    mDepthBuffer->SetMinFilter(GL_NEAREST);
-    mDepthBuffer->SetMagFilter(GL_NEAREST);
-    mDepthBuffer->Unbind();
+    mDepthBuffer = ProfileRenderer::createDepthBuffer();
 
     mPreCallback = std::make_unique<FramebufferCallback>(mDepthBuffer.get());
 
@@ -162,6 +81,9 @@ Sharad::Sharad(std::shared_ptr<cs::core::Settings> settings, std::string const&
 
     VistaOpenSGMaterialTools::SetSortKeyOnSubtree(
         mPreCallbackNode.get(), static_cast<int>(cs::utils::DrawOrder::eOpaqueNonHDR) + 1);
+
+    mThreadPool = std::make_unique<cs::utils::ThreadPool>(
+        std::max(1U, std::thread::hardware_concurrency()));
   }
 
   ++mInstanceCount;
@@ -201,13 +123,9 @@ Sharad::Sharad(std::shared_ptr<cs::core::Settings> settings, std::string const&
   fclose(pFile);
 
   // create geometry ---------------------------------------------------------
-  struct Vertex {
-    glm::vec3 pos;
-    glm::vec2 tc;
-    float     time;
-  };
-
-  std::vector<Vertex> vertices(mSamples * 2);
+  std::vector<glm::vec3> positions(mSamples);
+  std::vector<float>     times(mSamples);
+  mSampleData.resize(mSamples);
 
   for (int i = 0; i < mSamples; ++i) {
     double tTime = cs::utils::convert::time::toSpice(
@@ -224,36 +142,16 @@ Sharad::Sharad(std::shared_ptr<cs::core::Settings> settings, std::string const&
         cs::utils::convert::toRadians(glm::dvec2(meta[i].Longitude, meta[i].Latitude)));
     glm::dvec3 point = cs::utils::convert::toCartesian(lngLat, 1.0, 1.0);
 
-    float x    = 1.F * static_cast<float>(i) / (static_cast<float>(mSamples) - 1.F);
-    auto  time = static_cast<float>(tTime - mStartExistence);
+    positions[i] = point;
+    times[i]     = static_cast<float>(tTime - mStartExistence);
 
-    vertices[i * 2 + 0].pos  = point;
-    vertices[i * 2 + 0].tc   = glm::vec2(x, 1.F);
-    vertices[i * 2 + 0].time = time;
-    vertices[i * 2 + 1].pos  = point;
-    vertices[i * 2 + 1].tc   = glm::vec2(x, 0.F);
-    vertices[i * 2 + 1].time = time;
+    mSampleData[i].mNumber          = meta[i].Number;
+    mSampleData[i].mTime            = tTime;
+    mSampleData[i].mLngLat          = glm::dvec2(meta[i].Longitude, meta[i].Latitude);
+    mSampleData[i].mSurfaceAltitude = meta[i].SurfaceAltitude;
   }
 
-  mVBO.Bind(GL_ARRAY_BUFFER);
-  mVBO.BufferData(vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-  mVBO.Release();
-
-  mVAO.EnableAttributeArray(0);
-  mVAO.SpecifyAttributeArrayFloat(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0, &mVBO);
-
-  mVAO.EnableAttributeArray(1);
-  mVAO.SpecifyAttributeArrayFloat(
-      1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<GLuint>(offsetof(Vertex, tc)), &mVBO);
-
-  mVAO.EnableAttributeArray(2);
-  mVAO.SpecifyAttributeArrayFloat(
-      2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), static_cast<GLuint>(offsetof(Vertex, time)), &mVBO);
-
-  // create sphere shader ----------------------------------------------------
-  mShader.InitVertexShaderFromString(VERT);
-  mShader.InitFragmentShaderFromString(FRAG);
-  mShader.Link();
+  mRenderer.setSamples(std::move(positions), std::move(times));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -268,6 +166,10 @@ Sharad::~Sharad() {
     mPreCallback.reset(nullptr);
     mDepthBuffer.reset(nullptr);
     mPreCallbackNode.reset(nullptr);
+
+    // This waits for all remaining extraction tasks. They only reference data which they share
+    // ownership of.
+    mThreadPool.reset(nullptr);
   }
 }
 
@@ -278,6 +180,186 @@ void Sharad::update(double tTime, cs::scene::CelestialObserver const& oObs) {
 
   mCurrTime   = tTime;
   mSceneScale = oObs.getAnchorScale();
+
+  // This is done here instead of in Do(), so that exports also progress while the profile is not
+  // drawn.
+  if ((mShowReflectors && getIsInExistence()) || mOnExportFinished) {
+    cs::utils::FrameTimings::ScopedTimer timer("Sharad Reflectors");
+    updateReflectors();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Sharad::setReflectorSettings(ReflectorExtractor::Settings const& settings) {
+  mReflectorSettings = settings;
+  mReflectorsDirty   = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Sharad::setShowReflectors(bool show) {
+  mShowReflectors = show;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Sharad::exportReflectors(std::string const& csvFile, std::function<void(bool)> onFinished) {
+  if (mSamples < 2) {
+    logger().warn(
+        "Failed to export SHARAD reflectors to '{}': The profile has no metadata!", csvFile);
+    onFinished(false);
+    return;
+  }
+
+  if (mOnExportFinished) {
+    mOnExportFinished(false);
+  }
+
+  mExportFile       = csvFile;
+  mOnExportFinished = std::move(onFinished);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Sharad::updateReflectors() {
+  if (mSamples < 2 || !finishReflectorExtraction()) {
+    return;
+  }
+
+  if (!mReflectorsDirty) {
+    if (mOnExportFinished) {
+      bool success = writeReflectors(mExportFile);
+
+      // The callback may request another export, so the members are reset first.
+      auto onFinished   = std::move(mOnExportFinished);
+      mOnExportFinished = nullptr;
+      mExportFile.clear();
+      onFinished(success);
+    }
+
+    return;
+  }
+
+  // Reading back a radargram stalls the pipeline. When many profiles need their reflectors at
+  // once, this is spread over several frames.
+  if (mRadargramReadThisFrame) {
+    return;
+  }
+
+  mRadargramReadThisFrame = true;
+  startReflectorExtraction(readRadargram());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<std::vector<uint8_t> const> Sharad::readRadargram() {
+  GLint width  = 0;
+  GLint height = 0;
+
+  mTexture->Bind();
+  glGetTexLevelParameteriv(mTexture->GetTarget(), 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(mTexture->GetTarget(), 0, GL_TEXTURE_HEIGHT, &height);
+
+  auto radargram = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(width) * height);
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(mTexture->GetTarget(), 0, GL_RED, GL_UNSIGNED_BYTE, radargram->data());
+  glPopClientAttrib();
+  mTexture->Unbind();
+
+  mRadargramWidth  = width;
+  mRadargramHeight = height;
+
+  return radargram;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Sharad::startReflectorExtraction(
+    std::shared_ptr<std::vector<uint8_t> const> const& radargram) {
+  mReflectorsDirty   = false;
+  mPendingReflectors = std::make_shared<ReflectorExtractor::Result>(
+      ReflectorExtractor::createResult(mRadargramWidth, mRadargramHeight, mReflectorSettings));
+
+  // Split the radargram into one block per thread, so that a single profile is processed by all
+  // threads of the pool.
+  int threads   = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+  int blockSize = std::max(
+      ReflectorExtractor::MIN_BLOCK_SIZE, (mRadargramWidth + threads - 1) / threads);
+
+  for (int startColumn = 0; startColumn < mRadargramWidth; startColumn += blockSize) {
+    mReflectorTasks.push_back(
+        mThreadPool->enqueue([radargram, result = mPendingReflectors,
+                                 settings = mReflectorSettings, startColumn, blockSize]() {
+          ReflectorExtractor::extractColumns(
+              *radargram, settings, startColumn, startColumn + blockSize, *result);
+        }));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Sharad::finishReflectorExtraction() {
+  if (!mPendingReflectors) {
+    return true;
+  }
+
+  for (auto& task : mReflectorTasks) {
+    if (task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+  }
+
+  mReflectorTasks.clear();
+  mReflectors = std::move(*mPendingReflectors);
+  mPendingReflectors.reset();
+
+  mRenderer.setReflectors(mReflectors);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool Sharad::writeReflectors(std::string const& csvFile) const {
+  std::ofstream file(csvFile);
+
+  if (!file) {
+    logger().error("Failed to export SHARAD reflectors: Cannot open file '{}'!", csvFile);
+    return false;
+  }
+
+  // The reflectors are given as radargram rows, counted from the top. The rows correspond to the
+  // two-way travel time of the radar signal. The surface altitude is taken from the metadata.
+  file.precision(12);
+  file << "number,time,longitude,latitude,surface_altitude";
+  for (int r = 0; r < mReflectors.mMaxReflectors; ++r) {
+    file << (r == 0 ? ",surface_row" : ",subsurface_row_" + std::to_string(r));
+  }
+  file << '\n';
+
+  for (int i = 0; i < mSamples && mReflectors.mWidth > 0; ++i) {
+    float x      = 1.F * static_cast<float>(i) / (static_cast<float>(mSamples) - 1.F);
+    int   column = static_cast<int>(std::round(x * static_cast<float>(mReflectors.mWidth - 1)));
+
+    auto const& sample = mSampleData[i];
+    file << sample.mNumber << "," << sample.mTime << "," << sample.mLngLat.x << ","
+         << sample.mLngLat.y << "," << sample.mSurfaceAltitude;
+
+    for (int r = 0; r < mReflectors.mMaxReflectors; ++r) {
+      file << ",";
+
+      float depth = mReflectors.getDepth(column, r);
+      if (depth >= 0.F) {
+        file << depth * static_cast<float>(mReflectors.mHeight) - 0.5F;
+      }
+    }
+
+    file << '\n';
+  }
+
+  return static_cast<bool>(file);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -286,57 +368,28 @@ bool Sharad::Do() {
   if (getIsInExistence()) {
     cs::utils::FrameTimings::ScopedTimer timer("Sharad");
 
-    mShader.Bind();
-
     // get modelview and projection matrices
     std::array<GLfloat, 16> glMatMV{};
     std::array<GLfloat, 16> glMatP{};
     glGetFloatv(GL_MODELVIEW_MATRIX, glMatMV.data());
     glGetFloatv(GL_PROJECTION_MATRIX, glMatP.data());
-    auto matMV = glm::make_mat4x4(glMatMV.data()) * glm::mat4(getWorldTransform());
-    glUniformMatrix4fv(
-        mShader.GetUniformLocation("uMatModelView"), 1, GL_FALSE, glm::value_ptr(matMV));
-    glUniformMatrix4fv(mShader.GetUniformLocation("uMatProjection"), 1, GL_FALSE, glMatP.data());
 
     std::array<GLint, 4> iViewport{};
     glGetIntegerv(GL_VIEWPORT, iViewport.data());
-    mShader.SetUniform(mShader.GetUniformLocation("uViewportPos"),
-        static_cast<float>(iViewport.at(0)), static_cast<float>(iViewport.at(1)));
-
-    mShader.SetUniform(mShader.GetUniformLocation("uSharadTexture"), 0);
-    mShader.SetUniform(mShader.GetUniformLocation("uDepthBuffer"), 1);
-    mShader.SetUniform(mShader.GetUniformLocation("uSceneScale"), static_cast<float>(mSceneScale));
-    mShader.SetUniform(
-        mShader.GetUniformLocation("uHeightScale"), mSettings->mGraphics.pHeightScale.get());
-    mShader.SetUniform(mShader.GetUniformLocation("uRadius"),
-        static_cast<float>(cs::core::SolarSystem::getRadii(getCenterName())[0]));
-    mShader.SetUniform(
-        mShader.GetUniformLocation("uTime"), static_cast<float>(mCurrTime - mStartExistence));
-    mShader.SetUniform(
-        mShader.GetUniformLocation("uFarClip"), cs::utils::getCurrentFarClipDistance());
-
-    mTexture->Bind(GL_TEXTURE0);
-    mDepthBuffer->Bind(GL_TEXTURE1);
-
-    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    // glDepthFunc(GL_GEQUAL);
-    // glDepthMask(false);
-    glDisable(GL_DEPTH_TEST);
-
-    // draw --------------------------------------------------------------------
-    mVAO.Bind();
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, mSamples * 2);
-    mVAO.Release();
-
-    // clean up ----------------------------------------------------------------
-    mTexture->Unbind(GL_TEXTURE0);
-
-    glPopAttrib();
-
-    mShader.Release();
+
+    auto radius = cs::core::SolarSystem::getRadii(getCenterName())[0];
+
+    ProfileRenderer::Uniforms uniforms;
+    uniforms.mModelView   = glm::make_mat4x4(glMatMV.data()) * glm::mat4(getWorldTransform());
+    uniforms.mProjection  = glm::make_mat4x4(glMatP.data());
+    uniforms.mViewportPos = glm::vec2(iViewport.at(0), iViewport.at(1));
+    uniforms.mHeightScale = mSettings->mGraphics.pHeightScale.get();
+    uniforms.mRadius      = static_cast<float>(radius);
+    uniforms.mTime        = static_cast<float>(mCurrTime - mStartExistence);
+    uniforms.mSceneScale  = static_cast<float>(mSceneScale);
+    uniforms.mFarClip     = cs::utils::getCurrentFarClipDistance();
+
+    mRenderer.draw(uniforms, mTexture.get(), mDepthBuffer.get(), mShowReflectors);
   }
 
   return true;
@@ -357,11 +410,12 @@ Sharad::FramebufferCallback::FramebufferCallback(VistaTexture* pDepthBuffer)
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool Sharad::FramebufferCallback::Do() {
-  std::array<GLint, 4> iViewport{};
-  glGetIntegerv(GL_VIEWPORT, iViewport.data());
-  mDepthBuffer->Bind();
-  glCopyTexImage2D(GL_TEXTURE_RECTANGLE, 0, GL_DEPTH_COMPONENT, iViewport.at(0), iViewport.at(1),
-      iViewport.at(2), iViewport.at(3), 0);
+  cs::utils::FrameTimings::ScopedTimer timer("Sharad Depth Copy");
+
+  // This is called once per frame before any profile is drawn.
+  mRadargramReadThisFrame = false;
+
+  ProfileRenderer::copyDepthBuffer(mDepthBuffer);
   return true;
 }
 
@@ -9,17 +9,24 @@
 
 #include "../../../src/cs-core/Settings.hpp"
 #include "../../../src/cs-scene/CelestialObject.hpp"
+#include "ProfileRenderer.hpp"
+#include "ReflectorExtractor.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
-#include <VistaOGLExt/VistaBufferObject.h>
-#include <VistaOGLExt/VistaGLSLShader.h>
-#include <VistaOGLExt/VistaVertexArrayObject.h>
 
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
+#include <vector>
 
 class VistaTexture;
 
+namespace cs::utils {
+class ThreadPool;
+} // namespace cs::utils
+
 namespace csp::sharad {
 
 /// Renders a single SHARAD image.
@@ -38,10 +45,50 @@ class Sharad : public cs::scene::CelestialObject, public IVistaOpenGLDraw {
 
   void update(double tTime, cs::scene::CelestialObserver const& oObs) override;
 
+  /// Configures the extraction of surface and subsurface reflectors from the radargram. The
+  /// reflectors are extracted lazily once they are shown or exported. While they are shown, the
+  /// extraction runs in the background and the lines appear once it is finished.
+  void setReflectorSettings(ReflectorExtractor::Settings const& settings);
+
+  /// If enabled, the extracted reflectors are drawn as lines on top of the radargram.
+  void setShowReflectors(bool show);
+
+  /// Writes the radargram rows of all reflectors at each sample of the profile to the given CSV
+  /// file. This does not block: the reflectors are extracted in the background if required and the
+  /// file is written in a later frame. Afterwards, onFinished is called with false if the file
+  /// could not be written. A previously requested export of this profile is replaced.
+  void exportReflectors(std::string const& csvFile, std::function<void(bool)> onFinished);
+
   bool Do() override;
   bool GetBoundingBox(VistaBoundingBox& bb) override;
 
  private:
+  struct Sample {
+    unsigned int mNumber;
+    double       mTime;
+    glm::dvec2   mLngLat;
+    float        mSurfaceAltitude;
+  };
+
+  /// Called each frame while reflectors are shown or exported. Uploads the results of a finished
+  /// extraction, starts a new one if the settings changed and writes a pending export.
+  void updateReflectors();
+
+  /// Downloads the radargram from the GPU. This stalls the pipeline, so all profiles together do
+  /// this at most once per frame.
+  std::shared_ptr<std::vector<uint8_t> const> readRadargram();
+
+  /// Schedules the extraction of the radargram's column blocks on the thread pool. The radargram
+  /// is only referenced by the tasks, so it is freed once they are finished.
+  void startReflectorExtraction(std::shared_ptr<std::vector<uint8_t> const> const& radargram);
+
+  /// Returns false if the extraction is still running. Else the results of the last extraction
+  /// (if any) are uploaded to the GPU.
+  bool finishReflectorExtraction();
+
+  /// Writes the current reflectors to the given CSV file. Returns false if this failed.
+  bool writeReflectors(std::string const& csvFile) const;
+
   class FramebufferCallback : public IVistaOpenGLDraw {
    public:
     FramebufferCallback(VistaTexture* pDepthBuffer);
@@ -60,19 +107,37 @@ class Sharad : public cs::scene::CelestialObject, public IVistaOpenGLDraw {
   static std::unique_ptr<VistaOpenGLNode>     mPreCallbackNode;
   static int                                  mInstanceCount;
 
+  // Reflector extraction tasks of all profiles are executed by this pool.
+  static std::unique_ptr<cs::utils::ThreadPool> mThreadPool;
+
+  // Set once a radargram has been read back in the current frame. Reset by FramebufferCallback.
+  static bool mRadargramReadThisFrame;
+
   std::shared_ptr<cs::core::Settings> mSettings;
   std::unique_ptr<VistaTexture>       mTexture;
 
-  VistaGLSLShader        mShader;
-  VistaVertexArrayObject mVAO;
-  VistaBufferObject      mVBO;
+  ProfileRenderer mRenderer;
+
+  ReflectorExtractor::Settings mReflectorSettings;
+  ReflectorExtractor::Result   mReflectors;
+  bool                         mReflectorsDirty = true;
+  bool                         mShowReflectors  = false;
 
-  int    mSamples;
+  // The pending result is filled by the tasks of the thread pool.
+  int                                         mRadargramWidth  = 0;
+  int                                         mRadargramHeight = 0;
+  std::shared_ptr<ReflectorExtractor::Result> mPendingReflectors;
+  std::vector<std::future<void>>              mReflectorTasks;
+
+  // Set while an export has been requested but not yet written.
+  std::string               mExportFile;
+  std::function<void(bool)> mOnExportFinished;
+
+  std::vector<Sample> mSampleData;
+
+  int    mSamples    = 0;
   double mCurrTime   = -1.0;
   double mSceneScale = -1.0;
-
-  static const char* VERT;
-  static const char* FRAG;
 };
 
 } // namespace csp::sharad
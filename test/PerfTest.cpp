@@ -0,0 +1,686 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/ProfileRenderer.hpp"
+#include "../src/ReflectorExtractor.hpp"
+
+#include <VistaOGLExt/VistaTexture.h>
+
+// The X11 headers define macros like "None" or "Status" which clash with other libraries. They are
+// not required, as no window system is used.
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// A headless frame-time regression test of the SHARAD profile rendering. It creates an offscreen
+// OpenGL 3.3 context (for example with Mesa's llvmpipe), renders a sphere and a set of synthetic
+// profiles along a scripted camera and time path and records the CPU and GPU time as well as the
+// number of draw calls and vertices of each frame. The draw calls and vertices are compared against
+// a stored baseline and a few frames are compared against golden images.
+//
+// Usage: csp-sharad-perf-test [--baseline-dir <dir>] [--output-dir <dir>] [--frames <n>]
+//                             [--check-times] [--time-tolerance <f>] [--image-tolerance <f>]
+//                             [--update]
+//
+// The timings depend on the hardware. Therefore they are only compared against the baseline with
+// --check-times, which only makes sense on the machine where the baseline was recorded. With
+// --update, the baseline and the golden images are overwritten with the current results.
+
+using csp::sharad::ProfileRenderer;
+using csp::sharad::ReflectorExtractor;
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int   WIDTH              = 256;
+const int   HEIGHT             = 144;
+const float PLANET_RADIUS      = 3389500.F;
+const float NEAR_CLIP          = 10000.F;
+const float FAR_CLIP           = 4.F * PLANET_RADIUS;
+const float HEIGHT_SCALE       = 10.F;
+const float PROFILE_DURATION   = 600.F;
+const int   PROFILE_COUNT      = 8;
+const int   PROFILE_SAMPLES    = 2000;
+const int   RADARGRAM_WIDTH    = 2048;
+const int   RADARGRAM_HEIGHT   = 512;
+const int   CHANNEL_TOLERANCE  = 8;
+const int   DEFAULT_FRAMES     = 120;
+const int   GOLDEN_FRAME_COUNT = 3;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* PLANET_VERT = R"(
+#version 330
+
+uniform mat4 uMatModelView;
+uniform mat4 uMatProjection;
+uniform float uRadius;
+
+layout(location = 0) in vec3 iPosition;
+
+out vec3 vNormal;
+out vec3 vPosition;
+
+void main()
+{
+    vNormal     = iPosition;
+    vPosition   = (uMatModelView * vec4(iPosition * uRadius, 1.0)).xyz;
+    gl_Position =  uMatProjection * vec4(vPosition, 1);
+}
+)";
+
+// Like in CosmoScout VR, the depth is written linearly. The profile shaders rely on this.
+const char* PLANET_FRAG = R"(
+#version 330
+
+uniform float uFarClip;
+
+in vec3 vNormal;
+in vec3 vPosition;
+
+layout(location = 0) out vec4 oColor;
+
+void main()
+{
+    float light = max(dot(normalize(vNormal), normalize(vec3(1, 1, 1))), 0.0);
+    oColor       = vec4(vec3(0.7, 0.4, 0.25) * (0.3 + 0.7 * light), 1.0);
+    gl_FragDepth = length(vPosition) / uFarClip;
+}
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Options {
+  std::string mBaselineDir    = CSP_SHARAD_PERF_BASELINE_DIR;
+  std::string mOutputDir      = ".";
+  int         mFrames         = DEFAULT_FRAMES;
+  bool        mCheckTimes     = false;
+  double      mTimeTolerance  = 0.5;
+  double      mImageTolerance = 0.005;
+  bool        mUpdate         = false;
+};
+
+struct Frame {
+  double mCPUTime   = 0.0;
+  double mGPUTime   = 0.0;
+  int    mDrawCalls = 0;
+  int    mVertices  = 0;
+};
+
+struct Image {
+  int                  mWidth  = 0;
+  int                  mHeight = 0;
+  std::vector<uint8_t> mPixels;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg  = argv[i];
+    bool        last = i + 1 >= argc;
+
+    if (arg == "--update") {
+      options.mUpdate = true;
+    } else if (arg == "--check-times") {
+      options.mCheckTimes = true;
+    } else if (arg == "--baseline-dir" && !last) {
+      options.mBaselineDir = argv[++i];
+    } else if (arg == "--output-dir" && !last) {
+      options.mOutputDir = argv[++i];
+    } else if (arg == "--frames" && !last) {
+      options.mFrames = std::atoi(argv[++i]);
+    } else if (arg == "--time-tolerance" && !last) {
+      options.mTimeTolerance = std::atof(argv[++i]);
+    } else if (arg == "--image-tolerance" && !last) {
+      options.mImageTolerance = std::atof(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+
+  return options.mFrames > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates an OpenGL 3.3 compatibility context without any window or pbuffer surface. Mesa's
+// surfaceless platform is preferred, as it works without a running X server.
+bool createContext() {
+  EGLDisplay display = EGL_NO_DISPLAY;
+
+  auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+  if (getPlatformDisplay) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    std::printf("Failed to initialize EGL!\n");
+    return false;
+  }
+
+  // The surface type defaults to EGL_WINDOW_BIT which is not supported by the surfaceless platform.
+  EGLint const configAttribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config      = nullptr;
+  EGLint    configCount = 0;
+
+  if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0 ||
+      !eglBindAPI(EGL_OPENGL_API)) {
+    std::printf("Failed to find an EGL config which supports OpenGL!\n");
+    return false;
+  }
+
+  EGLint const contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+      EGL_CONTEXT_MINOR_VERSION_KHR, 3, EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+      EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR, EGL_NONE};
+
+  EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+
+  if (context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    std::printf("Failed to create an OpenGL 3.3 context!\n");
+    return false;
+  }
+
+  // There is no window, so glewInit() cannot be used.
+  glewExperimental = GL_TRUE;
+  if (glewContextInit() != GLEW_OK) {
+    std::printf("Failed to initialize GLEW!\n");
+    return false;
+  }
+
+  std::printf("Using %s (%s).\n", reinterpret_cast<char const*>(glGetString(GL_RENDERER)),
+      reinterpret_cast<char const*>(glGetString(GL_VERSION)));
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Profiles along meridians on the side of the planet which faces the camera.
+std::vector<glm::vec3> createProfile(int profile) {
+  std::vector<glm::vec3> positions(PROFILE_SAMPLES);
+
+  float lng = glm::radians(-35.F + 70.F * static_cast<float>(profile) / (PROFILE_COUNT - 1.F));
+
+  for (int i = 0; i < PROFILE_SAMPLES; ++i) {
+    float lat = glm::radians(-50.F + 100.F * static_cast<float>(i) / (PROFILE_SAMPLES - 1.F));
+    positions[i] =
+        glm::vec3(std::cos(lat) * std::sin(lng), std::sin(lat), std::cos(lat) * std::cos(lng));
+  }
+
+  return positions;
+}
+
+std::vector<float> createTimes() {
+  std::vector<float> times(PROFILE_SAMPLES);
+
+  for (int i = 0; i < PROFILE_SAMPLES; ++i) {
+    times[i] = PROFILE_DURATION * static_cast<float>(i) / (PROFILE_SAMPLES - 1.F);
+  }
+
+  return times;
+}
+
+// A noisy radargram with an undulating surface and a subsurface layer.
+std::vector<uint8_t> createRadargram(int seed) {
+  std::vector<uint8_t>               radargram(RADARGRAM_WIDTH * RADARGRAM_HEIGHT);
+  std::mt19937                       rng(seed);
+  std::uniform_int_distribution<int> noise(0, 10);
+
+  for (int c = 0; c < RADARGRAM_WIDTH; ++c) {
+    int surface    = RADARGRAM_HEIGHT / 3 + static_cast<int>(20.0 * std::sin(c * 0.01 + seed));
+    int subsurface = surface + 60 + c % 40;
+
+    for (int r = 0; r < RADARGRAM_HEIGHT; ++r) {
+      int value = noise(rng);
+
+      if (r >= surface) {
+        value += static_cast<int>(180.0 * std::exp(-(r - surface) / 40.0));
+      }
+
+      if (r >= subsurface && r < subsurface + 8) {
+        value += 120;
+      }
+
+      radargram[r * RADARGRAM_WIDTH + c] = static_cast<uint8_t>(std::min(value, 255));
+    }
+  }
+
+  return radargram;
+}
+
+std::unique_ptr<VistaTexture> createTexture(std::vector<uint8_t> const& radargram) {
+  auto texture = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+  texture->Bind();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, RADARGRAM_WIDTH, RADARGRAM_HEIGHT, 0, GL_RED,
+      GL_UNSIGNED_BYTE, radargram.data());
+  texture->SetWrapS(GL_CLAMP_TO_EDGE);
+  texture->SetWrapT(GL_CLAMP_TO_EDGE);
+  texture->SetMinFilter(GL_LINEAR);
+  texture->SetMagFilter(GL_LINEAR);
+  texture->Unbind();
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The planet is a simple UV sphere with a radius of one.
+std::vector<glm::vec3> createSphere(int slices, int stacks) {
+  std::vector<glm::vec3> vertices;
+
+  auto point = [&](int slice, int stack) {
+    float lng = glm::two_pi<float>() * static_cast<float>(slice) / static_cast<float>(slices);
+    float lat = glm::pi<float>() * (static_cast<float>(stack) / static_cast<float>(stacks) - 0.5F);
+    return glm::vec3(std::cos(lat) * std::sin(lng), std::sin(lat), std::cos(lat) * std::cos(lng));
+  };
+
+  for (int stack = 0; stack < stacks; ++stack) {
+    for (int slice = 0; slice < slices; ++slice) {
+      vertices.push_back(point(slice, stack));
+      vertices.push_back(point(slice + 1, stack));
+      vertices.push_back(point(slice + 1, stack + 1));
+      vertices.push_back(point(slice, stack));
+      vertices.push_back(point(slice + 1, stack + 1));
+      vertices.push_back(point(slice, stack + 1));
+    }
+  }
+
+  return vertices;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool writeImage(std::string const& path, Image const& image) {
+  std::ofstream file(path, std::ios::binary);
+  file << "P6\n" << image.mWidth << " " << image.mHeight << "\n255\n";
+  file.write(reinterpret_cast<char const*>(image.mPixels.data()),
+      static_cast<std::streamsize>(image.mPixels.size()));
+  return static_cast<bool>(file);
+}
+
+bool readImage(std::string const& path, Image& image) {
+  std::ifstream file(path, std::ios::binary);
+  std::string   magic;
+  int           maxValue = 0;
+
+  file >> magic >> image.mWidth >> image.mHeight >> maxValue;
+  file.get();
+
+  if (!file || magic != "P6" || maxValue != 255 || image.mWidth <= 0 || image.mHeight <= 0) {
+    return false;
+  }
+
+  image.mPixels.resize(static_cast<size_t>(image.mWidth) * image.mHeight * 3);
+  file.read(reinterpret_cast<char*>(image.mPixels.data()),
+      static_cast<std::streamsize>(image.mPixels.size()));
+  return static_cast<bool>(file);
+}
+
+// Reads the color attachment of the currently bound framebuffer. The rows are flipped so that the
+// image is stored top-down.
+Image readFramebuffer() {
+  Image image;
+  image.mWidth  = WIDTH;
+  image.mHeight = HEIGHT;
+  image.mPixels.resize(WIDTH * HEIGHT * 3);
+
+  std::vector<uint8_t> pixels(WIDTH * HEIGHT * 3);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  for (int y = 0; y < HEIGHT; ++y) {
+    std::copy_n(&pixels[(HEIGHT - 1 - y) * WIDTH * 3], WIDTH * 3, &image.mPixels[y * WIDTH * 3]);
+  }
+
+  return image;
+}
+
+// Returns the fraction of pixels where any channel differs by more than CHANNEL_TOLERANCE.
+double compareImages(Image const& a, Image const& b) {
+  if (a.mWidth != b.mWidth || a.mHeight != b.mHeight) {
+    return 1.0;
+  }
+
+  size_t differing = 0;
+
+  for (size_t i = 0; i < a.mPixels.size(); i += 3) {
+    for (size_t c = 0; c < 3; ++c) {
+      if (std::abs(a.mPixels[i + c] - b.mPixels[i + c]) > CHANNEL_TOLERANCE) {
+        ++differing;
+        break;
+      }
+    }
+  }
+
+  return static_cast<double>(differing) / static_cast<double>(a.mPixels.size() / 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 == 1 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+std::vector<int> getGoldenFrames(int frames) {
+  std::vector<int> goldenFrames;
+
+  for (int i = 0; i < GOLDEN_FRAME_COUNT; ++i) {
+    int frame = (frames - 1) * i / (GOLDEN_FRAME_COUNT - 1);
+    if (goldenFrames.empty() || goldenFrames.back() != frame) {
+      goldenFrames.push_back(frame);
+    }
+  }
+
+  return goldenFrames;
+}
+
+std::string getImageName(int frame) {
+  return "frame_" + std::to_string(frame) + ".ppm";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+
+  if (!parseOptions(argc, argv, options)) {
+    std::printf("Usage: %s [--baseline-dir <dir>] [--output-dir <dir>] [--frames <n>] "
+                "[--check-times] [--time-tolerance <f>] [--image-tolerance <f>] [--update]\n",
+        argv[0]);
+    return 1;
+  }
+
+  if (!createContext()) {
+    return 1;
+  }
+
+  // offscreen framebuffer -----------------------------------------------------------------------
+  GLuint framebuffer = 0;
+  GLuint colorBuffer = 0;
+  GLuint depthBuffer = 0;
+
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::printf("Failed to create the offscreen framebuffer!\n");
+    return 1;
+  }
+
+  glViewport(0, 0, WIDTH, HEIGHT);
+
+  // scene ---------------------------------------------------------------------------------------
+  VistaGLSLShader planetShader;
+  planetShader.InitVertexShaderFromString(PLANET_VERT);
+  planetShader.InitFragmentShaderFromString(PLANET_FRAG);
+  planetShader.Link();
+
+  auto                   sphere = createSphere(128, 64);
+  VistaBufferObject      planetVBO;
+  VistaVertexArrayObject planetVAO;
+
+  planetVBO.Bind(GL_ARRAY_BUFFER);
+  planetVBO.BufferData(sphere.size() * sizeof(glm::vec3), sphere.data(), GL_STATIC_DRAW);
+  planetVBO.Release();
+
+  planetVAO.EnableAttributeArray(0);
+  planetVAO.SpecifyAttributeArrayFloat(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0, &planetVBO);
+
+  // Each profile gets its own radargram, the reflectors are extracted synchronously.
+  std::vector<std::unique_ptr<ProfileRenderer>> renderers;
+  std::vector<std::unique_ptr<VistaTexture>>    textures;
+
+  for (int p = 0; p < PROFILE_COUNT; ++p) {
+    auto radargram  = createRadargram(p);
+    auto reflectors = ReflectorExtractor::extract(
+        radargram, RADARGRAM_WIDTH, RADARGRAM_HEIGHT, ReflectorExtractor::Settings());
+
+    renderers.push_back(std::make_unique<ProfileRenderer>());
+    renderers.back()->setSamples(createProfile(p), createTimes());
+    renderers.back()->setReflectors(reflectors);
+    textures.push_back(createTexture(radargram));
+  }
+
+  auto sceneDepth = ProfileRenderer::createDepthBuffer();
+
+  GLuint query = 0;
+  glGenQueries(1, &query);
+
+  // render the scripted frames ------------------------------------------------------------------
+  // The camera orbits the planet while the time passes the end of the profiles, so that they are
+  // revealed progressively.
+  std::vector<Frame> frames(options.mFrames);
+  auto               goldenFrames = getGoldenFrames(options.mFrames);
+  std::vector<Image> images;
+
+  glm::mat4 projection = glm::perspective(
+      glm::radians(50.F), static_cast<float>(WIDTH) / HEIGHT, NEAR_CLIP, FAR_CLIP);
+
+  for (int f = 0; f < options.mFrames; ++f) {
+    float progress = options.mFrames > 1 ? static_cast<float>(f) / (options.mFrames - 1.F) : 0.F;
+    float angle    = glm::radians(-25.F + 50.F * progress);
+
+    glm::vec3 eye = 2.6F * PLANET_RADIUS * glm::vec3(std::sin(angle), 0.3F, std::cos(angle));
+    glm::mat4 modelView = glm::lookAt(eye, glm::vec3(0.F), glm::vec3(0.F, 1.F, 0.F));
+
+    glClearColor(0.F, 0.F, 0.F, 1.F);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    planetShader.Bind();
+    glUniformMatrix4fv(planetShader.GetUniformLocation("uMatModelView"), 1, GL_FALSE,
+        glm::value_ptr(modelView));
+    glUniformMatrix4fv(planetShader.GetUniformLocation("uMatProjection"), 1, GL_FALSE,
+        glm::value_ptr(projection));
+    planetShader.SetUniform(planetShader.GetUniformLocation("uRadius"), PLANET_RADIUS);
+    planetShader.SetUniform(planetShader.GetUniformLocation("uFarClip"), FAR_CLIP);
+    planetVAO.Bind();
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(sphere.size()));
+    planetVAO.Release();
+    planetShader.Release();
+
+    // Only the work of the plugin is measured. This corresponds to the "Sharad" timer. Drivers
+    // like llvmpipe defer the rasterization of the planet until the depth buffer is read, so it
+    // has to be finished before the timers are started.
+    glFinish();
+
+    ProfileRenderer::Uniforms uniforms;
+    uniforms.mModelView   = modelView;
+    uniforms.mProjection  = projection;
+    uniforms.mHeightScale = HEIGHT_SCALE;
+    uniforms.mRadius      = PLANET_RADIUS;
+    uniforms.mTime        = 1.2F * PROFILE_DURATION * progress;
+    uniforms.mFarClip     = FAR_CLIP;
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    auto start = std::chrono::steady_clock::now();
+
+    ProfileRenderer::copyDepthBuffer(sceneDepth.get());
+
+    for (int p = 0; p < PROFILE_COUNT; ++p) {
+      auto statistics = renderers[p]->draw(uniforms, textures[p].get(), sceneDepth.get(), true);
+      frames[f].mDrawCalls += statistics.mDrawCalls;
+      frames[f].mVertices += statistics.mVertices;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    glEndQuery(GL_TIME_ELAPSED);
+
+    GLuint64 gpuTime = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuTime);
+
+    frames[f].mCPUTime = std::chrono::duration<double, std::milli>(end - start).count();
+    frames[f].mGPUTime = static_cast<double>(gpuTime) * 1e-6;
+
+    if (std::find(goldenFrames.begin(), goldenFrames.end(), f) != goldenFrames.end()) {
+      images.push_back(readFramebuffer());
+    }
+  }
+
+  glDeleteQueries(1, &query);
+
+  // write the results ---------------------------------------------------------------------------
+  std::vector<double> cpuTimes;
+  std::vector<double> gpuTimes;
+  int64_t             drawCalls = 0;
+  int64_t             vertices  = 0;
+
+  std::ofstream csv(options.mOutputDir + "/frames.csv");
+  csv << "frame,cpu_ms,gpu_ms,draw_calls,vertices\n";
+
+  for (int f = 0; f < options.mFrames; ++f) {
+    csv << f << "," << frames[f].mCPUTime << "," << frames[f].mGPUTime << ","
+        << frames[f].mDrawCalls << "," << frames[f].mVertices << "\n";
+
+    cpuTimes.push_back(frames[f].mCPUTime);
+    gpuTimes.push_back(frames[f].mGPUTime);
+    drawCalls += frames[f].mDrawCalls;
+    vertices += frames[f].mVertices;
+  }
+
+  for (size_t i = 0; i < goldenFrames.size(); ++i) {
+    writeImage(options.mOutputDir + "/" + getImageName(goldenFrames[i]), images[i]);
+  }
+
+  nlohmann::json results = {{"width", WIDTH}, {"height", HEIGHT}, {"frames", options.mFrames},
+      {"cpuMedianMs", median(cpuTimes)}, {"gpuMedianMs", median(gpuTimes)},
+      {"drawCalls", drawCalls}, {"vertices", vertices}};
+
+  std::printf("%d frames: CPU %.3f ms, GPU %.3f ms (median), %lld draw calls, %lld vertices\n",
+      options.mFrames, median(cpuTimes), median(gpuTimes), static_cast<long long>(drawCalls),
+      static_cast<long long>(vertices));
+
+  std::string baselinePath = options.mBaselineDir + "/baseline.json";
+
+  if (options.mUpdate) {
+    std::ofstream(baselinePath) << results.dump(2) << "\n";
+
+    for (size_t i = 0; i < goldenFrames.size(); ++i) {
+      writeImage(options.mBaselineDir + "/" + getImageName(goldenFrames[i]), images[i]);
+    }
+
+    std::printf("Updated the baseline in '%s'.\n", options.mBaselineDir.c_str());
+    return 0;
+  }
+
+  // compare with the baseline -------------------------------------------------------------------
+  std::ifstream baselineFile(baselinePath);
+
+  if (!baselineFile) {
+    std::printf("There is no baseline at '%s'! Run with --update on the reference machine to "
+                "create one.\n",
+        baselinePath.c_str());
+    return 1;
+  }
+
+  nlohmann::json baseline;
+
+  try {
+    baselineFile >> baseline;
+  } catch (std::exception const& e) {
+    std::printf("Failed to parse '%s': %s\n", baselinePath.c_str(), e.what());
+    return 1;
+  }
+
+  int failures = 0;
+
+  auto fail = [&failures](std::string const& message) {
+    std::printf("FAILED: %s\n", message.c_str());
+    ++failures;
+  };
+
+  for (auto const& key : {"width", "height", "frames", "drawCalls", "vertices"}) {
+    if (baseline.value(key, int64_t(-1)) != results[key].get<int64_t>()) {
+      fail(std::string(key) + " is " + results[key].dump() + " but " +
+           (baseline.contains(key) ? baseline[key].dump() : "missing") + " in the baseline");
+    }
+  }
+
+  if (options.mCheckTimes) {
+    for (auto const& key : {"cpuMedianMs", "gpuMedianMs"}) {
+      double expected = baseline.value(key, 0.0);
+      double actual   = results[key].get<double>();
+
+      if (actual > expected * (1.0 + options.mTimeTolerance)) {
+        fail(std::string(key) + " is " + std::to_string(actual) +
+             " which exceeds the baseline of " + std::to_string(expected) + " by more than " +
+             std::to_string(options.mTimeTolerance * 100.0) + "%");
+      }
+    }
+  } else {
+    std::printf("The baseline times (CPU %.3f ms, GPU %.3f ms) are not compared. Use "
+                "--check-times on the machine where the baseline was recorded.\n",
+        baseline.value("cpuMedianMs", 0.0), baseline.value("gpuMedianMs", 0.0));
+  }
+
+  for (size_t i = 0; i < goldenFrames.size(); ++i) {
+    std::string name = getImageName(goldenFrames[i]);
+    Image       golden;
+
+    if (!readImage(options.mBaselineDir + "/" + name, golden)) {
+      fail("failed to read the golden image " + name);
+    } else {
+      double difference = compareImages(images[i], golden);
+      if (difference > options.mImageTolerance) {
+        fail(std::to_string(difference * 100.0) + "% of the pixels of " + name +
+             " differ from the golden image");
+      }
+    }
+  }
+
+  if (failures > 0) {
+    std::printf("%d checks failed. The results have been written to '%s'.\n", failures,
+        options.mOutputDir.c_str());
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}
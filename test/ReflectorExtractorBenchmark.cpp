@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/ReflectorExtractor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Measures the time required to extract the reflectors of a synthetic full-length profile. The
+// radargram size can be given as "csp-sharad-benchmark <width> <height>". It is processed with a
+// single thread and with all hardware threads.
+
+using csp::sharad::ReflectorExtractor;
+
+int main(int argc, char** argv) {
+  int width  = argc > 1 ? std::atoi(argv[1]) : 20000;
+  int height = argc > 2 ? std::atoi(argv[2]) : 3600;
+
+  if (width <= 0 || height <= 0) {
+    std::printf("Usage: %s [<width> <height>]\n", argv[0]);
+    return 1;
+  }
+
+  // A noisy radargram with an undulating surface and a subsurface layer.
+  std::vector<uint8_t>               radargram(static_cast<size_t>(width) * height);
+  std::mt19937                       rng(0);
+  std::uniform_int_distribution<int> noise(0, 10);
+
+  for (int c = 0; c < width; ++c) {
+    int surface    = height / 6 + static_cast<int>(height / 30.0 * std::sin(c * 0.001));
+    int subsurface = surface + height / 10 + c % 50;
+
+    for (int r = 0; r < height; ++r) {
+      int value = noise(rng);
+
+      if (r >= surface) {
+        value += static_cast<int>(150.0 * std::exp(-(r - surface) / 80.0));
+      }
+
+      if (r >= subsurface && r < subsurface + 20) {
+        value += 90;
+      }
+
+      radargram[static_cast<size_t>(r) * width + c] = static_cast<uint8_t>(std::min(value, 255));
+    }
+  }
+
+  ReflectorExtractor::Settings settings;
+  int const                    iterations = 5;
+
+  std::vector<unsigned> threadCounts = {1U};
+  if (std::thread::hardware_concurrency() > 1) {
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  }
+
+  for (unsigned threads : threadCounts) {
+    double best = 0.0;
+
+    for (int i = 0; i < iterations; ++i) {
+      auto start  = std::chrono::steady_clock::now();
+      auto result = ReflectorExtractor::extract(radargram, width, height, settings, threads);
+      auto end    = std::chrono::steady_clock::now();
+
+      double ms = std::chrono::duration<double, std::milli>(end - start).count();
+      best      = i == 0 ? ms : std::min(best, ms);
+
+      // Make sure that the result is actually used.
+      if (result.mDepths.empty()) {
+        return 1;
+      }
+    }
+
+    std::printf("%dx%d radargram, %u thread(s): %.1f ms (best of %d)\n", width, height, threads,
+        best, iterations);
+  }
+
+  return 0;
+}
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/ReflectorExtractor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Correctness tests of the ReflectorExtractor on synthetic radargrams. The executable returns a
+// non-zero exit code if any check fails.
+
+using csp::sharad::ReflectorExtractor;
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gFailedChecks = 0;
+
+void check(bool condition, std::string const& what, char const* file, int line) {
+  if (!condition) {
+    std::printf("%s:%d: check failed: %s\n", file, line, what.c_str());
+    ++gFailedChecks;
+  }
+}
+
+#define CHECK(condition) check(condition, #condition, __FILE__, __LINE__)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A radargram where each column is described by a list of (row, intensity) pairs. Starting at the
+// given row, all pixels below have the given intensity until the next pair starts.
+std::vector<uint8_t> createRadargram(int width, int height,
+    std::function<std::vector<std::pair<int, uint8_t>>(int column)> const& layers) {
+  std::vector<uint8_t> radargram(static_cast<size_t>(width) * height, 0);
+
+  for (int c = 0; c < width; ++c) {
+    for (auto const& layer : layers(c)) {
+      for (int r = layer.first; r < height; ++r) {
+        radargram[static_cast<size_t>(r) * width + c] = layer.second;
+      }
+    }
+  }
+
+  return radargram;
+}
+
+// Returns the radargram row of the given reflector or -1 if it is missing.
+float getRow(ReflectorExtractor::Result const& result, int column, int reflector) {
+  float depth = result.getDepth(column, reflector);
+  return depth < 0.F ? -1.F : depth * static_cast<float>(result.mHeight) - 0.5F;
+}
+
+bool isRow(ReflectorExtractor::Result const& result, int column, int reflector, float row) {
+  return std::abs(getRow(result, column, reflector) - row) < 1e-3F;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testStepEdge() {
+  auto radargram = createRadargram(8, 400, [](int) {
+    return std::vector<std::pair<int, uint8_t>>{{100, 200}};
+  });
+
+  // The reflector has to be placed at the first bright row, regardless of the amount of smoothing.
+  for (int radius = 0; radius <= 8; ++radius) {
+    ReflectorExtractor::Settings settings;
+    settings.mSmoothingRadius = radius;
+
+    auto result = ReflectorExtractor::extract(radargram, 8, 400, settings, 1);
+
+    for (int c = 0; c < 8; ++c) {
+      CHECK(isRow(result, c, 0, 100.F));
+      CHECK(getRow(result, c, 1) < 0.F);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testLayer() {
+  // A surface followed by a brighter layer of 20 rows. The falling edge at the bottom of the layer
+  // must not be reported.
+  auto radargram = createRadargram(8, 600, [](int) {
+    return std::vector<std::pair<int, uint8_t>>{{100, 80}, {300, 255}, {320, 80}};
+  });
+
+  ReflectorExtractor::Settings settings;
+  auto result = ReflectorExtractor::extract(radargram, 8, 600, settings, 1);
+
+  for (int c = 0; c < 8; ++c) {
+    CHECK(isRow(result, c, 0, 100.F));
+    CHECK(isRow(result, c, 1, 300.F));
+    CHECK(getRow(result, c, 2) < 0.F);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testThresholds() {
+  // A weak step which is below the default gradient threshold.
+  auto radargram = createRadargram(8, 400, [](int) {
+    return std::vector<std::pair<int, uint8_t>>{{100, 2}};
+  });
+
+  ReflectorExtractor::Settings settings;
+  auto result = ReflectorExtractor::extract(radargram, 8, 400, settings, 1);
+  CHECK(getRow(result, 0, 0) < 0.F);
+
+  settings.mGradientThreshold  = 0.F;
+  settings.mIntensityThreshold = 0.F;
+  result                       = ReflectorExtractor::extract(radargram, 8, 400, settings, 1);
+  CHECK(isRow(result, 0, 0, 100.F));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testMinSeparation() {
+  auto radargram = createRadargram(8, 400, [](int) {
+    return std::vector<std::pair<int, uint8_t>>{{100, 80}, {105, 160}, {200, 240}};
+  });
+
+  ReflectorExtractor::Settings settings;
+  settings.mSmoothingRadius = 1;
+  settings.mMinSeparation   = 10;
+
+  auto result = ReflectorExtractor::extract(radargram, 8, 400, settings, 1);
+  CHECK(isRow(result, 0, 0, 100.F));
+  CHECK(isRow(result, 0, 1, 200.F));
+  CHECK(getRow(result, 0, 2) < 0.F);
+
+  settings.mMinSeparation = 5;
+
+  result = ReflectorExtractor::extract(radargram, 8, 400, settings, 1);
+  CHECK(isRow(result, 0, 0, 100.F));
+  CHECK(isRow(result, 0, 1, 105.F));
+  CHECK(isRow(result, 0, 2, 200.F));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testMaxReflectors() {
+  auto radargram = createRadargram(8, 600, [](int) {
+    return std::vector<std::pair<int, uint8_t>>{
+        {50, 60}, {100, 100}, {150, 140}, {200, 180}, {250, 220}, {300, 255}};
+  });
+
+  ReflectorExtractor::Settings settings;
+  settings.mMaxReflectors = 2;
+
+  auto result = ReflectorExtractor::extract(radargram, 8, 600, settings, 1);
+  CHECK(result.mMaxReflectors == 2);
+  CHECK(result.mDepths.size() == 16);
+  CHECK(isRow(result, 0, 0, 50.F));
+  CHECK(isRow(result, 0, 1, 100.F));
+
+  settings.mMaxReflectors = 0;
+  result                  = ReflectorExtractor::extract(radargram, 8, 600, settings, 1);
+  CHECK(result.mDepths.empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testSmallRadargrams() {
+  ReflectorExtractor::Settings settings;
+
+  for (int height = 0; height < 5; ++height) {
+    std::vector<uint8_t> radargram(static_cast<size_t>(8) * height, 255);
+    if (height > 2) {
+      radargram.assign(radargram.size(), 0);
+      std::fill(radargram.begin() + 8 * (height / 2), radargram.end(), 255);
+    }
+
+    auto result = ReflectorExtractor::extract(radargram, 8, height, settings, 1);
+    CHECK(result.mDepths.size() == 8 * static_cast<size_t>(settings.mMaxReflectors));
+
+    for (float depth : result.mDepths) {
+      CHECK(depth < 0.F);
+    }
+  }
+
+  // A radargram which is smaller than the given size must not be accessed.
+  std::vector<uint8_t> radargram(10, 0);
+  auto                 result = ReflectorExtractor::extract(radargram, 8, 100, settings, 1);
+  CHECK(getRow(result, 0, 0) < 0.F);
+
+  // An empty radargram.
+  result = ReflectorExtractor::extract({}, 0, 0, settings, 1);
+  CHECK(result.mDepths.empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testBlockBoundaries() {
+  // Every column has its reflectors at different rows. With four threads, the 200 columns are
+  // split into blocks of 64 columns; the results must be independent of this.
+  int const width  = 200;
+  int const height = 500;
+
+  auto radargram = createRadargram(width, height, [](int c) {
+    return std::vector<std::pair<int, uint8_t>>{{50 + c % 37, 100}, {300 + c % 13, 250}};
+  });
+
+  ReflectorExtractor::Settings settings;
+  auto single = ReflectorExtractor::extract(radargram, width, height, settings, 1);
+  auto multi  = ReflectorExtractor::extract(radargram, width, height, settings, 4);
+
+  CHECK(single.mDepths == multi.mDepths);
+
+  for (int c : {0, 63, 64, 127, 128, 191, 192, 199}) {
+    CHECK(isRow(multi, c, 0, static_cast<float>(50 + c % 37)));
+    CHECK(isRow(multi, c, 1, static_cast<float>(300 + c % 13)));
+  }
+
+  // Processing arbitrary column ranges must give the same result as well.
+  auto ranges = ReflectorExtractor::createResult(width, height, settings);
+  ReflectorExtractor::extractColumns(radargram, settings, 0, 63, ranges);
+  ReflectorExtractor::extractColumns(radargram, settings, 63, 65, ranges);
+  ReflectorExtractor::extractColumns(radargram, settings, 65, 1000, ranges);
+
+  CHECK(single.mDepths == ranges.mDepths);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+int main() {
+  testStepEdge();
+  testLayer();
+  testThresholds();
+  testMinSeparation();
+  testMaxReflectors();
+  testSmallRadargrams();
+  testBlockBoundaries();
+
+  if (gFailedChecks > 0) {
+    std::printf("%d checks failed.\n", gFailedChecks);
+    return 1;
+  }
+
+  std::printf("All checks passed.\n");
+  return 0;
+}